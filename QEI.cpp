@@ -1,234 +1,520 @@
 #include "QEI.h"
 
-QEI::QEI(PinName channelA, PinName channelB, PinName index, Encoding encoding) : _channelA(channelA, PullUp), _channelB(channelB, PullUp), _index(index)
+QEIBase::QEIBase(PinName channelA, PinName channelB, PinName index, Encoding encoding) : _channelA(channelA, PullUp), _channelB(channelB, PullUp), _index(index)
 {
+    _pinA = channelA;
+    _pinB = channelB;
+    _pinIndex = index;
+    _encoding = encoding;
     _pulses = 0;
+    _pulsesHigh = 0;
     _revolutions = 0;
+    _indexMode = INDEX_COUNT;
+    _nCountsPerRev = 0;
+    _nIndexPulses = 0;
+    _nIndexReference = 0;
+    _bIndexReferenced = false;
+    _nIndexLastCount = 0;
+    _bIndexSeen = false;
     _fSpeedFactor = 1.0;
     _fPositionFactor = 1.0;
+    _nSpeedScale = qei_ratio_q48(1, 1);
+    _nPositionScale = qei_ratio_q48(1, 1);
+
+    _fSpeed = 0;
+
+    _edgeLog = NULL;
+    _compare = NULL;
+    _events = NULL;
 
-    _nSpeedLastTimer = 0;
-    _nSpeedAvrTimeSum = 0;
-    _nSpeedAvrTimeCount = -1;
-    _fLastSpeed = 0;
-    _nSpeedTimeoutMax = 10;
-    _nSpeedTimeoutCount = 0;
+    _bFilter = false;
+    _nFilterSamples = 1;
+    _nFilterMinPulseWidth = 0;
+    _nFilterMinPulseWidthUs = 0;
+    _bFilterHeld = false;
+    _nFilterHeldState = 0;
+    _nFilterHeldTime = 0;
+    _nFilterRejected = 0;
+
+    _nInvalid = 0;
+    _nIndexMismatches = 0;
+    _nIndexError = 0;
+    _nLostCaptures = 0;
+    _nMinEdgeInterval = (us_timestamp_t)-1;
 
     _SpeedTimer.reset();
     _SpeedTimer.start();
+    _nTimebase = 1000000;
+
+#if QEI_PROFILE
+    qei_profile_reset(_profileEncode);
+    qei_profile_reset(_profileSpeedSnapshot);
+    QEICycleCounter::enable();
+#endif
+
+    //Workout what the current state is, unless the states come from elsewhere.
+    if (channelA != NC && channelB != NC)
+    {
+        int chanA = _channelA.read();
+        int chanB = _channelB.read();
 
-    //Workout what the current state is.
-    int chanA = _channelA.read();
-    int chanB = _channelB.read();
+        //2-bit state
+        _currState = (chanA << 1) | (chanB);
+        _prevState = _currState;
+    }
 
-    //2-bit state
-    _currState = (chanA << 1) | (chanB);
-    _prevState = _currState;
+    //Index is optional.
+    if (index != NC)
+    {
+        _index.rise(callback(this, &QEIBase::index));
+    }
+}
 
+QEI::QEI(PinName channelA, PinName channelB, PinName index, Encoding encoding) : QEIBase(channelA, channelB, index, encoding)
+{
     //X2 encoding uses interrupts on only channel A.
     //X4 encoding uses interrupts on both channel A and B.
-    _encoding = encoding;
-    _channelA.rise(callback(this, &QEI::encode));
-    _channelA.fall(callback(this, &QEI::encode));
-
     if (_encoding == X4_ENCODING)
     {
-        _channelB.rise(callback(this, &QEI::encode));
-        _channelB.fall(callback(this, &QEI::encode));
+        _channelA.rise(callback(this, &QEI::encodeX4));
+        _channelA.fall(callback(this, &QEI::encodeX4));
+        _channelB.rise(callback(this, &QEI::encodeX4));
+        _channelB.fall(callback(this, &QEI::encodeX4));
     }
-
-    //Index is optional.
-    if (index != NC)
+    else
     {
-        _index.rise(callback(this, &QEI::index));
+        _channelA.rise(callback(this, &QEI::encodeX2));
+        _channelA.fall(callback(this, &QEI::encodeX2));
     }
 }
 
-QEI::~QEI()
+QEIBase::~QEIBase()
 {
-    _channelA.rise(NULL);
-    _channelA.fall(NULL);
-    _channelB.rise(NULL);
-    _channelB.fall(NULL);
+    //An InterruptIn on NC has no EXTI line, setting its handlers would change line 0 on STM32.
+    if (_pinA != NC)
+    {
+        _channelA.rise(NULL);
+        _channelA.fall(NULL);
+    }
+    if (_pinB != NC)
+    {
+        _channelB.rise(NULL);
+        _channelB.fall(NULL);
+    }
+    if (_pinIndex != NC)
+        _index.rise(NULL);
 }
 
-void QEI::reset()
+void QEIBase::reset()
 {
-    _pulses = 0;
+    __disable_irq();
+    setPulses(0);
     _revolutions = 0;
+    _nIndexPulses = 0;
+    _bIndexReferenced = false;
+    _bIndexSeen = false;
+    __enable_irq();
+}
+
+int QEIBase::read()
+{
+    return (int)_pulses;
 }
 
-int QEI::read()
+void QEIBase::write(int pulses)
 {
-    return _pulses;
+    write64(pulses);
+}
+
+int64_t QEIBase::read64()
+{
+    int32_t high;
+    uint32_t low;
+
+    do
+    {
+        high = _pulsesHigh;
+        low = _pulses;
+    } while (high != _pulsesHigh);
+
+    return (int64_t)(((uint64_t)(uint32_t)high << 32) | low);
 }
 
-void QEI::write(int pulses)
+void QEIBase::write64(int64_t pulses)
 {
-    _pulses = pulses;
+    __disable_irq();
+    setPulses(pulses);
+    //The INDEX_CORRECT reference and the mismatch check were relative to the old count.
+    _bIndexReferenced = false;
+    _bIndexSeen = false;
+    __enable_irq();
+}
+
+int QEIBase::getRevolutions()
+{
+    return _revolutions;
+}
+
+int64_t QEIBase::getIndexPulses()
+{
+    int revolutions;
+    int64_t pulses;
+
+    //index() updates the latch before the revolution count, retry if it ran meanwhile.
+    do
+    {
+        revolutions = _revolutions;
+        pulses = _nIndexPulses;
+    } while (revolutions != _revolutions);
+
+    return pulses;
 }
 
-void QEI::setSpeedFactor(float fSpeedFactor)
+void QEIBase::setIndexMode(IndexMode mode)
+{
+    __disable_irq();
+    _indexMode = mode;
+    _bIndexReferenced = false;
+    __enable_irq();
+}
+
+void QEIBase::setCountsPerRevolution(int nCountsPerRev)
+{
+    __disable_irq();
+    _nCountsPerRev = nCountsPerRev;
+    _bIndexReferenced = false;
+    __enable_irq();
+}
+
+void QEIBase::setSpeedFactor(float fSpeedFactor)
 {
     _fSpeedFactor = fSpeedFactor;
 }
 
-float QEI::getSpeed()
+float QEIBase::getSpeed()
+{
+    sampleSpeed();
+    _fSpeed = _speed.getSpeed(_fSpeedFactor);
+
+    return _fSpeed;
+}
+
+float QEIBase::getAcceleration()
+{
+    return _speed.getAcceleration(_fSpeedFactor);
+}
+
+void QEIBase::sampleSpeed()
+{
+#if QEI_PROFILE
+    uint32_t profileStart = QEICycleCounter::read();
+#endif
+    _speed.sample(now());
+#if QEI_PROFILE
+    qei_profile_add(_profileSpeedSnapshot, QEICycleCounter::read() - profileStart);
+#endif
+}
+
+void QEIBase::setSpeedRatio(int32_t nNumerator, int32_t nDenominator)
+{
+    _nSpeedScale = qei_ratio_q48(nNumerator, nDenominator);
+}
+
+int32_t QEIBase::getSpeedQ16()
+{
+    sampleSpeed();
+    return _speed.getSpeedQ16(_nSpeedScale);
+}
+
+void QEIBase::setPositionRatio(int32_t nNumerator, int32_t nDenominator)
+{
+    _nPositionScale = qei_ratio_q48(nNumerator, nDenominator);
+}
+
+int32_t QEIBase::getPositionQ16()
+{
+    return scalePositionQ16(read64() * 65536);
+}
+
+float QEIBase::getPositionInterpolated()
+{
+    return (float)readInterpolatedQ16() * (_fPositionFactor / 65536.0f);
+}
+
+int32_t QEIBase::getPositionInterpolatedQ16()
+{
+    return scalePositionQ16(readInterpolatedQ16());
+}
+
+int64_t QEIBase::readInterpolatedQ16()
+{
+    unsigned int edgeCount;
+    int64_t pulses;
+    us_timestamp_t edgeTimer;
+
+    //Pair the count with the time of the edge which produced it.
+    do
+    {
+        edgeCount = _speed.getEdgeCount();
+        pulses = read64();
+        edgeTimer = _speed.getLastEdgeTime();
+    } while (edgeCount != _speed.getEdgeCount());
+
+    int counts = _speed.getCounts();
+    if (counts == 0)
+        return pulses * 65536;
+
+    //Pulses since the last edge at the estimated speed, kept below one pulse.
+    us_timestamp_t elapsed = now() - edgeTimer;
+    uint64_t magnitude = (uint64_t)(counts > 0 ? counts : -counts);
+    int64_t fraction = 65535;
+    if (elapsed < _speed.getTime() / magnitude)
+    {
+        uint64_t scaled = (magnitude * elapsed * 65536) / _speed.getTime();
+        if (scaled < 65535)
+            fraction = (int64_t)scaled;
+    }
+
+    return pulses * 65536 + (counts > 0 ? fraction : -fraction);
+}
+
+int32_t QEIBase::scalePositionQ16(int64_t pulsesQ16)
+{
+    return qei_scale_q48(pulsesQ16, _nPositionScale);
+}
+
+void QEIBase::setGlitchFilter(unsigned int nSamples, unsigned int nMinPulseWidth)
+{
+    __disable_irq();
+    _nFilterSamples = (nSamples > 1) ? nSamples : 1;
+    _nFilterMinPulseWidth = (us_timestamp_t)nMinPulseWidth * _nTimebase / 1000000;
+    _nFilterMinPulseWidthUs = nMinPulseWidth;
+    //Count an edge still held by the previous setting.
+    _filterTimeout.detach();
+    if (_bFilterHeld)
+    {
+        _bFilterHeld = false;
+        countHeld();
+    }
+    _bFilter = (_nFilterSamples > 1 || _nFilterMinPulseWidth > 0);
+    __enable_irq();
+}
+
+unsigned int QEIBase::getRejectedEdges()
+{
+    return _nFilterRejected;
+}
+
+QEIDiagnostics QEIBase::getDiagnostics()
 {
-    // float fSpeed;
-    int avrTimeSum = 0;
-    int avrTimeCount = 0;
+    QEIDiagnostics diagnostics;
+    us_timestamp_t minEdgeInterval;
+
+    //The 64-bit interval is the only multi-word field, copy it atomically.
+    __disable_irq();
+    minEdgeInterval = _nMinEdgeInterval;
+    __enable_irq();
+
+    diagnostics.invalidTransitions = _nInvalid;
+    diagnostics.rejectedEdges = _nFilterRejected;
+    diagnostics.indexMismatches = _nIndexMismatches;
+    diagnostics.lastIndexError = _nIndexError;
+    diagnostics.lostCaptures = _nLostCaptures;
+    //Reported in microseconds whatever the timebase, the unset maximum stays saturated.
+    us_timestamp_t minEdgeIntervalUs = (minEdgeInterval == (us_timestamp_t)-1) ? minEdgeInterval : minEdgeInterval * 1000000 / _nTimebase;
+    diagnostics.minEdgeInterval = (minEdgeIntervalUs > 0xFFFFFFFF) ? 0xFFFFFFFF : (unsigned int)minEdgeIntervalUs;
+    diagnostics.maxEdgeRate = (minEdgeInterval > 0) ? (unsigned int)(_nTimebase / minEdgeInterval) : _nTimebase;
+
+    return diagnostics;
+}
 
+void QEIBase::resetDiagnostics()
+{
     __disable_irq();
-    avrTimeSum = _nSpeedAvrTimeSum;
-    avrTimeCount = _nSpeedAvrTimeCount;
-    _nSpeedAvrTimeSum = 0;
-    _nSpeedAvrTimeCount = 0;
+    _nInvalid = 0;
+    _nFilterRejected = 0;
+    _nIndexMismatches = 0;
+    _nIndexError = 0;
+    _nLostCaptures = 0;
+    _nMinEdgeInterval = (us_timestamp_t)-1;
     __enable_irq();
+}
 
-    if (avrTimeCount == 0)
+bool QEIBase::filter(int state, us_timestamp_t time)
+{
+    //All re-reads must agree with the first one.
+    for (unsigned int i = 1; i < _nFilterSamples; i++)
     {
-        if (_nSpeedTimeoutCount++ > _nSpeedTimeoutMax)
-            _fLastSpeed *= 0.5f;
-        _fSpeed = _fLastSpeed;
+        if (((_channelA.read() << 1) | _channelB.read()) != state)
+        {
+            _nFilterRejected++;
+            return false;
+        }
     }
-    else if (avrTimeCount < 0 || avrTimeSum == 0)
+
+    if (_nFilterMinPulseWidth == 0)
+        return true;
+
+    if (_bFilterHeld)
     {
-        _fSpeed = 0;
-        _nSpeedTimeoutCount = 0;
+        _bFilterHeld = false;
+
+        //Back to the state before the held edge within the minimum width:
+        //both edges were a glitch and neither is counted.
+        if (state == _currState && time - _nFilterHeldTime < _nFilterMinPulseWidth)
+        {
+            _filterTimeout.detach();
+            _nFilterRejected++;
+            return false;
+        }
+
+        //The encoder moved on, the held edge was real.
+        countHeld();
     }
-    else
+
+    //Nothing to hold if the state did not change.
+    if (state == _currState)
+        return true;
+
+    _nFilterHeldState = state;
+    _nFilterHeldTime = time;
+    _bFilterHeld = true;
+    _filterTimeout.attach_us(callback(this, &QEIBase::filterTimeout), _nFilterMinPulseWidthUs);
+    return false;
+}
+
+void QEIBase::filterTimeout()
+{
+    //The ticker interrupt may not preempt the edge interrupt, or the other way round.
+    __disable_irq();
+    if (_bFilterHeld)
     {
-        _fSpeed = 1000000.0f * _fSpeedFactor / ((float)avrTimeSum / (float)avrTimeCount);
-        _nSpeedTimeoutCount = 0;
+        _bFilterHeld = false;
+        countHeld();
     }
-    _fLastSpeed = _fSpeed;
+    __enable_irq();
+}
 
-    return _fSpeed;
+void QEIBase::countHeld()
+{
+    if (_encoding == X4_ENCODING)
+        count<X4_ENCODING>(_nFilterHeldState, _nFilterHeldTime);
+    else
+        count<X2_ENCODING>(_nFilterHeldState, _nFilterHeldTime);
 }
 
-void QEI::setPositionFactor(float fPositionFactor)
+us_timestamp_t QEIBase::now()
+{
+    return _SpeedTimer.read_high_resolution_us();
+}
+
+uint32_t QEIBase::getTimebase()
+{
+    return _nTimebase;
+}
+
+void QEIBase::setTimebase(uint32_t nFrequency)
+{
+    _nTimebase = nFrequency;
+    _speed.setFrequency(nFrequency);
+}
+
+void QEIBase::process(int state, us_timestamp_t time)
+{
+    if (_encoding == X4_ENCODING)
+        process<X4_ENCODING>(state, time);
+    else
+        process<X2_ENCODING>(state, time);
+}
+
+void QEIBase::setCompare(QEICompare *compare)
+{
+    __disable_irq();
+    _compare = compare;
+    if (compare != NULL)
+        compare->arm(read64());
+    __enable_irq();
+}
+
+void QEIBase::setEvents(QEIEvents *events)
+{
+    _events = events;
+}
+
+void QEIBase::setEdgeLog(QEIEdgeBuffer *edgeLog)
+{
+    _edgeLog = edgeLog;
+}
+
+void QEIBase::setPositionFactor(float fPositionFactor)
 {
     _fPositionFactor = fPositionFactor;
 }
 
-float QEI::getPosition()
-{
-    return (float)_pulses * _fPositionFactor;
-}
-
-// +-------------+
-// | X2 Encoding |
-// +-------------+
-//
-// When observing states two patterns will appear:
-//
-// Counter clockwise rotation:
-//
-// 10 -> 01 -> 10 -> 01 -> ...
-//
-// Clockwise rotation:
-//
-// 11 -> 00 -> 11 -> 00 -> ...
-//
-// We consider counter clockwise rotation to be "forward" and
-// counter clockwise to be "backward". Therefore pulse count will increase
-// during counter clockwise rotation and decrease during clockwise rotation.
-//
-// +-------------+
-// | X4 Encoding |
-// +-------------+
-//
-// There are four possible states for a quadrature encoder which correspond to
-// 2-bit gray code.
-//
-// A state change is only valid if of only one bit has changed.
-// A state change is invalid if both bits have changed.
-//
-// Clockwise Rotation ->
-//
-//    00 01 11 10 00
-//
-// <- Counter Clockwise Rotation
-//
-// If we observe any valid state changes going from left to right, we have
-// moved one pulse clockwise [we will consider this "backward" or "negative"].
-//
-// If we observe any valid state changes going from right to left we have
-// moved one pulse counter clockwise [we will consider this "forward" or
-// "positive"].
-//
-// We might enter an invalid state for a number of reasons which are hard to
-// predict - if this is the case, it is generally safe to ignore it, update
-// the state and carry on, with the error correcting itself shortly after.
+float QEIBase::getPosition()
+{
+    return (float)read64() * _fPositionFactor;
+}
 
 void QEI::encode()
 {
-    int change = -1;
-    int chanA = _channelA.read();
-    int chanB = _channelB.read();
+    if (_encoding == X4_ENCODING)
+        encodeX4();
+    else
+        encodeX2();
+}
+
+void QEI::encodeX2()
+{
+    decode<X2_ENCODING>();
+}
 
-    //2-bit state
-    _currState = (chanA << 1) | chanB;
+void QEI::encodeX4()
+{
+    decode<X4_ENCODING>();
+}
 
-    if (_encoding == X2_ENCODING)
+void QEIBase::index()
+{
+    int64_t pulses = read64();
+    _nIndexPulses = pulses;
+
+    //One revolution, in either direction, since the last index edge.
+    if (_nCountsPerRev > 0 && _bIndexSeen)
     {
-        //11->00->11->00 is counter clockwise rotation or "forward".
-        if ((_prevState == 0x03 && _currState == 0x00) || (_prevState == 0x00 && _currState == 0x02))
-        {
-            _pulses++;
-            change = 0;
-        }
-        //10->01->10->01 is clockwise rotation or "backward".
-        else if ((_prevState == 0x02 && _currState == 0x01) || (_prevState == 0x01 && _currState == 0x02))
+        int64_t distance = pulses - _nIndexLastCount;
+        if (distance != _nCountsPerRev && distance != -_nCountsPerRev)
         {
-            _pulses--;
-            change = 1;
+            _nIndexError = (int)((distance >= 0 ? distance : -distance) - _nCountsPerRev);
+            _nIndexMismatches++;
         }
     }
-    else if (_encoding == X4_ENCODING)
+
+    if (_indexMode == INDEX_RESET)
     {
-        //Entered a new valid state.
-        if (((_currState ^ _prevState) != INVALID) && (_currState != _prevState))
-        {
-            //2 bit state. Right hand bit of prev XOR left hand bit of current
-            //give 0 if counter clockwise rotation and 1 if clockwise rotation
-            change = (_prevState & PREV_MASK) ^ ((_currState & CURR_MASK) >> 1);
-            if (change == 0)
-            {
-                _pulses++;
-            }
-            else if (change == 1)
-            {
-                _pulses--;
-            }
-        }
+        setPulses(0);
     }
-    _prevState = _currState;
-
-    if (change != -1)
+    else if (_indexMode == INDEX_CORRECT && _nCountsPerRev > 0)
     {
-        unsigned int act = _SpeedTimer.read_us();
-        unsigned int diff = act - _nSpeedLastTimer;
-        _nSpeedLastTimer = act;
-
-        if (_nSpeedAvrTimeCount < 0)
+        if (!_bIndexReferenced)
         {
-            _nSpeedAvrTimeSum = 0;
-            _nSpeedAvrTimeCount = 0;
+            _nIndexReference = pulses;
+            _bIndexReferenced = true;
         }
         else
         {
-            if (change == 0)
-                _nSpeedAvrTimeSum += diff;
-            else
-                _nSpeedAvrTimeSum -= diff;
-            _nSpeedAvrTimeCount++;
+            //Round to the nearest whole revolution from the reference.
+            int64_t diff = pulses - _nIndexReference;
+            int64_t half = _nCountsPerRev / 2;
+            int64_t revs = (diff >= 0 ? diff + half : diff - half) / _nCountsPerRev;
+            setPulses(_nIndexReference + revs * _nCountsPerRev);
         }
     }
-}
 
-void QEI::index()
-{
+    _nIndexLastCount = read64();
+    _bIndexSeen = true;
     _revolutions++;
+
+    if (_events != NULL)
+        _events->post(QEIEvents::INDEX_EVENT);
 }
\ No newline at end of file
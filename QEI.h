@@ -106,6 +106,12 @@
 #define _QEI_H_
 
 #include "mbed.h"
+#include "QEIDecoder.h"
+#include "QEIEdgeLog.h"
+#include "QEISpeed.h"
+#include "QEICompare.h"
+#include "QEIEvents.h"
+#include "QEIProfile.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -116,36 +122,41 @@
 #define INVALID 0x03   //XORing two states where both bits have changed
 
 /**
- * Quadrature Encoder Interface.
+ * Decoding error counters, see QEIBase::getDiagnostics().
+ */
+typedef struct QEIDiagnostics
+{
+    unsigned int invalidTransitions; //Edges where both channels had changed, a lost edge each
+    unsigned int rejectedEdges;      //Edges rejected or cancelled by the glitch filter
+    unsigned int indexMismatches;    //Index to index distances different from the counts per revolution
+    int lastIndexError;              //Distance minus counts per revolution at the last mismatch
+    unsigned int minEdgeInterval;    //Shortest time between two counted edges in us
+    unsigned int maxEdgeRate;        //Inverse of minEdgeInterval, in edges per second
+    unsigned int lostCaptures;       //Input captures overwritten before they were read, QEICapture only
+} QEIDiagnostics;
+
+/**
+ * Quadrature Encoder Interface common state.
+ *
+ * Holds the channels, counters and speed measurement shared by QEI and QEIT.
+ * The state decoding itself is inherited from QEIDecoder.
+ * Derived classes decide how the channel A/B edges are dispatched to decode().
  */
-class QEI
+class QEIBase : public QEIDecoder
 {
 
 public:
-    typedef enum Encoding
+    typedef enum IndexMode
     {
-        X2_ENCODING,
-        X4_ENCODING
-    } Encoding;
-
-    /**
-     * Contructor
-     * Read the current values on channel A and B to determine the initial state
-     * 
-     * Attaches the encode fuction to rise/fall interrupt edges of channels A and B to perform X4 encoding.
-     * Attaches the index fuction to the rise interrupt edge of channel index(if it is used) to count revolutions.
-     * 
-     * @param channelA mbed pin for channel A input
-     * @param channelB mbed pin for channel B input
-     * @param index mbed pin for optional index channel input, (pass NC if not needed).
-     * @param encoding The encoding to use. Uses X2 encoding by default.
-     */
-    QEI(PinName channelA, PinName channelB, PinName index, Encoding encoding = X4_ENCODING);
+        INDEX_COUNT,  //Only count revolutions and latch the pulse count
+        INDEX_RESET,  //Also set the pulse count to zero on every index edge
+        INDEX_CORRECT //Also snap the pulse count to a whole number of revolutions from the first index edge
+    } IndexMode;
 
     /**
      * Destructor
      */
-    ~QEI();
+    virtual ~QEIBase();
 
     /**
      * Reset the encoder.
@@ -156,7 +167,7 @@ public:
 
     /**
      * Read the number of pulses recorded by the encoder.
-     * @return Number of pulses which have occured.
+     * @return Number of pulses which have occured, wraps after 2^32 pulses.
      */
     int read();
 
@@ -166,6 +177,49 @@ public:
      */
     void write(int pulses);
 
+    /**
+     * Read the extended number of pulses recorded by the encoder.
+     * 
+     * Does not disable interrupts, the read is retried if an edge carried into
+     * the high word meanwhile. Call it from thread context or from an interrupt
+     * with lower priority than the encoder edges.
+     * @return Number of pulses which have occured.
+     */
+    int64_t read64();
+
+    /**
+     * Sets the extended number of pulses
+     * @param pulses Number of pulses which to set.
+     */
+    void write64(int64_t pulses);
+
+    /**
+     * Read the number of index edges since the last reset.
+     * @return Number of revolutions which have occured.
+     */
+    int getRevolutions();
+
+    /**
+     * Read the pulse count latched at the last index edge.
+     * The value is taken before INDEX_RESET or INDEX_CORRECT adjust the count.
+     * @return Pulse count at the last index edge, 0 if there was none.
+     */
+    int64_t getIndexPulses();
+
+    /**
+     * Sets what happens to the pulse count on each index edge.
+     * @param mode The index mode to use. INDEX_COUNT by default.
+     */
+    void setIndexMode(IndexMode mode);
+
+    /**
+     * Sets the number of pulses per revolution, X*CPR.
+     * Where X is encoding type [e.g. X4 encoding => X=4]
+     * Required by INDEX_CORRECT, which does nothing while it is 0.
+     * @param nCountsPerRev - pulses between two index edges
+     */
+    void setCountsPerRevolution(int nCountsPerRev);
+
     /**
      * Sets the factor for the getter-functions to convert in another unit.
      * (1.0=Hz, 1/(X*CPR)=rps, 1/(60*X*CPR)=rpm, 360/(X*CPR)=°/s)
@@ -176,6 +230,10 @@ public:
 
     /**
      * Gets the speed as float value.
+     * 
+     * Uses the M/T method, see QEISpeedEstimator, so call it at a fixed rate.
+     * Does not disable interrupts. Call it from thread context or from an
+     * interrupt with lower priority than the encoder edges.
      * @return speed The value is scales by the factor set by setSpeedFactor()
      */
     float getSpeed();
@@ -194,43 +252,483 @@ public:
      */
     float getPosition();
 
+    /**
+     * Gets the acceleration as float value.
+     * 
+     * Difference of the last two speed estimates over the time between them,
+     * so it is updated by getSpeed()/getSpeedQ16() and does not sample itself.
+     * @return acceleration The value is scales by the factor set by setSpeedFactor(), per second
+     */
+    float getAcceleration();
+
+    /**
+     * Sets the integer ratio for the fixed-point speed getter.
+     * (1/1=Hz, 1/(X*CPR)=rps, 60/(X*CPR)=rpm, 360/(X*CPR)=°/s)
+     * Converted to a multiplier here, see qei_ratio_q48(), so the getter does not divide.
+     * @param nNumerator - numerator of the factor from Hz to user unit
+     * @param nDenominator - denominator of the factor, must not be 0
+     */
+    void setSpeedRatio(int32_t nNumerator, int32_t nDenominator);
+
+    /**
+     * Gets the speed as Q16.16 fixed-point value, without float arithmetic.
+     * Takes the same M/T sample as getSpeed(), so use one or the other.
+     * Within one LSB of the exact value for ratios up to 1. Saturates at
+     * +-32768 user units, e.g. 32767 Hz at the default ratio of 1/1: use a
+     * ratio which keeps the speed range below that, or getSpeed().
+     * @return speed The value is scaled by the ratio set by setSpeedRatio()
+     */
+    int32_t getSpeedQ16();
+
+    /**
+     * Sets the integer ratio for the fixed-point position getter.
+     * (1/1=Count, 1/(X*CPR)=revolution, 360/(X*CPR)=deg)
+     * Converted to a multiplier here, see qei_ratio_q48(), so the getters do not divide.
+     * @param nNumerator - numerator of the factor from counts to user unit
+     * @param nDenominator - denominator of the factor, must be positive
+     */
+    void setPositionRatio(int32_t nNumerator, int32_t nDenominator);
+
+    /**
+     * Gets the position as Q16.16 fixed-point value, without float arithmetic.
+     * Rounded to the nearest LSB, so it matches getPosition() with the same
+     * factor within one LSB while the result fits in Q16.16. Saturates at
+     * +-32768 user units, e.g. 32767 counts at the default ratio of 1/1: use
+     * revolutions or read64() for larger ranges.
+     * @return position The value is scaled by the ratio set by setPositionRatio()
+     */
+    int32_t getPositionQ16();
+
+    /**
+     * Gets the position including the fraction of a pulse since the last edge.
+     * 
+     * Extrapolates from the last edge with the speed estimate of the last
+     * getSpeed()/getSpeedQ16() call, so call one of them at the control rate.
+     * The fraction is clamped below one pulse, so the result never crosses
+     * the next count boundary before the edge actually arrives.
+     * @return position The value is scales by the factor set by setPositionFactor()
+     */
+    float getPositionInterpolated();
+
+    /**
+     * Gets the interpolated position as Q16.16 fixed-point value.
+     * @return position The value is scaled by the ratio set by setPositionRatio()
+     */
+    int32_t getPositionInterpolatedQ16();
+
+    /**
+     * Sets the glitch filter applied to every edge before it is decoded.
+     * 
+     * nSamples re-reads the channels in the interrupt and rejects the edge
+     * unless all reads agree, which drops spikes shorter than the reads.
+     * nMinPulseWidth holds every edge back for that many microseconds: it is
+     * counted when a Timeout expires or the next edge moves on, with its own
+     * time, and dropped together with the next edge if that returns to the
+     * previous state sooner. So a glitch never reaches the counter, compare
+     * targets, events or edge log, at the cost of a Timeout per edge and of
+     * the count lagging the pins by nMinPulseWidth.
+     * @param nSamples - consecutive equal reads required, 0 or 1 disables it
+     * @param nMinPulseWidth - minimum pulse width in us, 0 disables it
+     */
+    void setGlitchFilter(unsigned int nSamples, unsigned int nMinPulseWidth);
+
+    /**
+     * Gets the number of edges rejected or cancelled by the glitch filter.
+     * @return Number of rejected edges.
+     */
+    unsigned int getRejectedEdges();
+
+    /**
+     * Gets the decoding error counters.
+     * 
+     * Invalid transitions are the signature of edge interrupts being lost at
+     * high speed. Index mismatches need setCountsPerRevolution() and assume
+     * the encoder keeps turning in one direction between index edges.
+     * Compare maxEdgeRate with the rate the interrupt can sustain to alarm
+     * before counts are lost.
+     * @return Counters since construction or resetDiagnostics().
+     */
+    QEIDiagnostics getDiagnostics();
+
+    /**
+     * Clears the decoding error counters.
+     */
+    void resetDiagnostics();
+
+    /**
+     * Gets the timebase of the edge times, e.g. for the edge log records.
+     * @return Ticks per second, 1000000 unless the backend uses a hardware timer.
+     */
+    uint32_t getTimebase();
+
+    /**
+     * Sets the log which receives a record for every edge interrupt.
+     * Costs a timer read and a few stores per edge while attached.
+     * @param edgeLog Log to fill, NULL to stop logging.
+     */
+    void setEdgeLog(QEIEdgeBuffer *edgeLog);
+
+    /**
+     * Sets the position compare checked on every count change, and arms its
+     * targets from the current count.
+     * Costs two compares per edge while attached.
+     * @param compare Compare to check, NULL to stop.
+     */
+    void setCompare(QEICompare *compare);
+
+    /**
+     * Sets the events the index edges and direction changes are posted to.
+     * Costs a compare per edge while attached, the work runs on the queue.
+     * @param events Events to post to, NULL to stop.
+     */
+    void setEvents(QEIEvents *events);
+
+#if QEI_PROFILE
+    /**
+     * Gets the cost of the edge interrupt decoding.
+     * @return Cycles per decoded edge, see QEICycleCounter.
+     */
+    const QEIProfile &getEncodeProfile() const
+    {
+        return _profileEncode;
+    }
+
+    /**
+     * Gets the cost of the getSpeed() snapshot of the edge interval totals.
+     * @return Cycles per getSpeed() call, see QEICycleCounter.
+     */
+    const QEIProfile &getSpeedSnapshotProfile() const
+    {
+        return _profileSpeedSnapshot;
+    }
+#endif
+
 protected:
+    /**
+     * Contructor
+     * Read the current values on channel A and B to determine the initial state
+     * 
+     * Attaches the index fuction to the rise interrupt edge of channel index(if it is used) to count revolutions.
+     * Channels A and B are left unattached, the derived class attaches them to decode().
+     * 
+     * @param channelA mbed pin for channel A input
+     * @param channelB mbed pin for channel B input
+     * @param index mbed pin for optional index channel input, (pass NC if not needed).
+     * @param encoding The encoding the derived class decodes with.
+     */
+    QEIBase(PinName channelA, PinName channelB, PinName index, Encoding encoding);
+
     /**
      * Update the pulse count
      * Called on every rising/falling edge of channels A/B
      * 
      * Read the state of the channels and determines whether a pulse forward or backward has occured, update the count appropriately.
+     * The encoding is a template argument so the decoding table is resolved at compile time.
      */
-    void encode();
+    template <Encoding E>
+    void decode();
+
+    /**
+     * Decode a state observed at a given time.
+     * Called by decode() with the pins and the speed timer, and by backends
+     * or drivers which get the state and time from elsewhere.
+     * @param state 2-bit state of the channels, (A << 1) | B.
+     * @param time Time of the state in timebase ticks, same timebase as now().
+     */
+    template <Encoding E>
+    void process(int state, us_timestamp_t time);
+
+    /**
+     * Decode a state observed at a given time, using the encoding chosen at construction.
+     */
+    void process(int state, us_timestamp_t time);
+
+    /**
+     * Count a state which passed the glitch filter: decoder, counter, speed,
+     * compare, events and edge log.
+     */
+    template <Encoding E>
+    void count(int state, us_timestamp_t time);
+
+    /**
+     * Gets the current time of the timebase used for the edge times.
+     * Called in thread context only, the edge interrupt is given its time.
+     * @return Time in timebase ticks, the speed timer in microseconds by default.
+     */
+    virtual us_timestamp_t now();
+
+    /**
+     * Sets the timebase of the times given to process() and returned by now().
+     * Called by backends with a hardware timebase, before any edge is processed.
+     * @param nFrequency Ticks per second, 1000000 for microseconds.
+     */
+    void setTimebase(uint32_t nFrequency);
 
     /**
      * Called on every rising edge of channel index to update revolution count by one
+     * Latches the pulse count and applies the index mode.
      */
     void index();
 
+    /**
+     * Update the speed estimate from the edges since the previous call.
+     */
+    void sampleSpeed();
+
+    /**
+     * Gets the pulse count in Q16.16 including the extrapolated fraction.
+     */
+    int64_t readInterpolatedQ16();
+
+    /**
+     * Scales a Q16.16 pulse count by the position ratio, rounded to nearest.
+     * A multiply and a shift, see qei_scale_q48().
+     */
+    int32_t scalePositionQ16(int64_t pulsesQ16);
+
+    /**
+     * Glitch filter stage of process(), only called while a filter is set.
+     * @param state 2-bit state given to process().
+     * @param time Time of the state.
+     * @return true if the edge is accepted.
+     */
+    bool filter(int state, us_timestamp_t time);
+
+    /**
+     * Counts the edge held by the minimum width stage, once it lasted long enough.
+     */
+    void filterTimeout();
+
+    /**
+     * Counts the held edge with the encoding chosen at construction.
+     */
+    void countHeld();
+
+    /**
+     * Adds to the pulse count from interrupt context.
+     * @param delta Pulse change, -1 or +1.
+     */
+    void addPulses(int delta)
+    {
+        uint32_t pulses = _pulses + delta;
+        _pulses = pulses;
+
+        //The low word just reached 0 or 0xFFFFFFFF, carry if it wrapped.
+        if ((uint32_t)(pulses + 1) <= 1)
+        {
+            if (pulses == 0 && delta > 0)
+                _pulsesHigh++;
+            else if (pulses != 0 && delta < 0)
+                _pulsesHigh--;
+        }
+
+        if (_compare != NULL)
+            _compare->check((int64_t)(((uint64_t)(uint32_t)_pulsesHigh << 32) | pulses));
+    }
+
+    /**
+     * Sets the pulse count from interrupt context, see write64() for thread context.
+     */
+    void setPulses(int64_t pulses)
+    {
+        _pulses = (uint32_t)pulses;
+        _pulsesHigh = (int32_t)((uint64_t)pulses >> 32);
+
+        if (_compare != NULL)
+            _compare->seek(pulses);
+    }
+
     InterruptIn _channelA;
     InterruptIn _channelB;
     InterruptIn _index;
+    PinName _pinA;     //Pins of the InterruptIns, handlers are only detached from connected ones
+    PinName _pinB;
+    PinName _pinIndex;
 
     Encoding _encoding;
-    int _prevState;
-    int _currState;
 
-    volatile int _pulses;
+    volatile uint32_t _pulses;     //Low word of the pulse count, updated on every edge
+    volatile int32_t _pulsesHigh; //High word, updated when the low word wraps
     volatile int _revolutions;
 
+    IndexMode _indexMode;
+    int _nCountsPerRev;
+    int64_t _nIndexPulses;     //Pulse count latched at the last index edge
+    int64_t _nIndexReference;  //Pulse count at the first index edge, for INDEX_CORRECT
+    bool _bIndexReferenced;
+    int64_t _nIndexLastCount;  //Pulse count after the last index edge was applied
+    bool _bIndexSeen;          //_nIndexLastCount is valid for the mismatch check
+
     float _fSpeedFactor;
     float _fPositionFactor;
+    int64_t _nSpeedScale;    //Speed ratio in Q16.48
+    int64_t _nPositionScale; //Position ratio in Q16.48
 
     Timer _SpeedTimer;
+    uint32_t _nTimebase; //Ticks per second of the edge times, see setTimebase()
 
-    unsigned int _nSpeedLastTimer;
-    unsigned int _nSpeedTimeoutMax;
-    unsigned int _nSpeedTimeoutCount;
-    int _nSpeedAvrTimeSum;
-    int _nSpeedAvrTimeCount;
-    float _fLastSpeed;
+    QEISpeedEstimator _speed;
     float _fSpeed;
+
+    QEIEdgeBuffer *_edgeLog;
+    QEICompare *_compare;
+    QEIEvents *_events;
+
+    bool _bFilter;                    //Any glitch filter stage enabled
+    unsigned int _nFilterSamples;
+    us_timestamp_t _nFilterMinPulseWidth; //In timebase ticks
+    unsigned int _nFilterMinPulseWidthUs;
+    bool _bFilterHeld;                //An edge waits for the minimum width
+    int _nFilterHeldState;            //State and time of the held edge
+    us_timestamp_t _nFilterHeldTime;
+    Timeout _filterTimeout;           //Counts the held edge after the minimum width
+    volatile unsigned int _nFilterRejected;
+
+    volatile unsigned int _nInvalid;
+    volatile unsigned int _nIndexMismatches;
+    volatile int _nIndexError;
+    volatile unsigned int _nLostCaptures; //Counted by backends with input capture
+    volatile us_timestamp_t _nMinEdgeInterval;
+
+#if QEI_PROFILE
+    QEIProfile _profileEncode;
+    QEIProfile _profileSpeedSnapshot;
+#endif
+};
+
+template <QEIBase::Encoding E>
+inline void QEIBase::decode()
+{
+#if QEI_PROFILE
+    uint32_t profileStart = QEICycleCounter::read();
+#endif
+
+    int chanA = _channelA.read();
+    int chanB = _channelB.read();
+
+    //2-bit state, timestamped in 64-bit microseconds so neither the 32-bit
+    //ticker wrap nor an interval longer than 71 minutes corrupts the speed.
+    process<E>((chanA << 1) | chanB, _SpeedTimer.read_high_resolution_us());
+
+#if QEI_PROFILE
+    qei_profile_add(_profileEncode, QEICycleCounter::read() - profileStart);
+#endif
+}
+
+template <QEIBase::Encoding E>
+inline void QEIBase::process(int state, us_timestamp_t time)
+{
+    if (!_bFilter || filter(state, time))
+        count<E>(state, time);
+}
+
+template <QEIBase::Encoding E>
+inline void QEIBase::count(int state, us_timestamp_t time)
+{
+    const Transition transition = step<E>(state);
+    _nInvalid += transition.invalid;
+
+    if (transition.delta != 0)
+    {
+        addPulses(transition.delta);
+
+        us_timestamp_t interval = time - _speed.getLastEdgeTime();
+        if (interval < _nMinEdgeInterval)
+            _nMinEdgeInterval = interval;
+        _speed.edge(transition.delta, time);
+
+        if (_events != NULL)
+            _events->edge(transition.delta);
+    }
+
+    if (_edgeLog != NULL)
+        _edgeLog->push((uint32_t)time, (uint8_t)_currState, transition.delta, transition.invalid);
+}
+
+/**
+ * Quadrature Encoder Interface with the encoding fixed at compile time.
+ *
+ * The edge interrupt calls a decoder specialized for E, so the hot path
+ * contains no encoding test at all.
+ *
+ * @code
+ * QEIT<QEI::X4_ENCODING> encoder(PA_0, PA_1, NC);
+ * @endcode
+ */
+template <QEIBase::Encoding E>
+class QEIT : public QEIBase
+{
+
+public:
+    /**
+     * Contructor
+     * Read the current values on channel A and B to determine the initial state
+     * 
+     * Attaches the encode fuction to rise/fall interrupt edges of channel A, and channel B as well for X4 encoding.
+     * Attaches the index fuction to the rise interrupt edge of channel index(if it is used) to count revolutions.
+     * 
+     * @param channelA mbed pin for channel A input
+     * @param channelB mbed pin for channel B input
+     * @param index mbed pin for optional index channel input, (pass NC if not needed).
+     */
+    QEIT(PinName channelA, PinName channelB, PinName index) : QEIBase(channelA, channelB, index, E)
+    {
+        _channelA.rise(callback(this, &QEIT::encode));
+        _channelA.fall(callback(this, &QEIT::encode));
+
+        if (E == X4_ENCODING)
+        {
+            _channelB.rise(callback(this, &QEIT::encode));
+            _channelB.fall(callback(this, &QEIT::encode));
+        }
+    }
+
+protected:
+    /**
+     * Update the pulse count
+     * Called on every rising/falling edge of channels A/B
+     */
+    void encode()
+    {
+        decode<E>();
+    }
+};
+
+/**
+ * Quadrature Encoder Interface.
+ *
+ * Selects the encoding at run time. The choice is made once when the edge
+ * interrupts are attached, so each edge still runs a specialized decoder.
+ */
+class QEI : public QEIBase
+{
+
+public:
+    /**
+     * Contructor
+     * Read the current values on channel A and B to determine the initial state
+     * 
+     * Attaches the encode fuction to rise/fall interrupt edges of channels A and B to perform X4 encoding.
+     * Attaches the index fuction to the rise interrupt edge of channel index(if it is used) to count revolutions.
+     * 
+     * @param channelA mbed pin for channel A input
+     * @param channelB mbed pin for channel B input
+     * @param index mbed pin for optional index channel input, (pass NC if not needed).
+     * @param encoding The encoding to use. Uses X2 encoding by default.
+     */
+    QEI(PinName channelA, PinName channelB, PinName index, Encoding encoding = X4_ENCODING);
+
+protected:
+    /**
+     * Update the pulse count using the encoding chosen at construction.
+     */
+    void encode();
+
+    /**
+     * Edge handlers attached by the constructor, one per encoding.
+     */
+    void encodeX2();
+    void encodeX4();
 };
 
 #endif
\ No newline at end of file
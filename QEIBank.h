@@ -0,0 +1,304 @@
+/**
+ * Bank of quadrature encoders sharing one GPIO port.
+ *
+ * Every channel pin still has its own InterruptIn, but all of them call the
+ * same handler. The handler reads the port input register once and decodes
+ * every encoder whose channel bits changed from that single word with the
+ * QEIDecoder tables, instead of running one callback per QEI object.
+ *
+ * With X4 encoding and every encoder on a bit pair 2p, 2p+1, all of them the
+ * same way round, the whole port is decoded at once with
+ * QEIDecoder::stepPacked() and only the encoders that moved are visited.
+ * stepPacked() wants channel A on the odd bit, so with channel A on the even
+ * bits the bits of each pair are swapped first, four operations per word.
+ *
+ * @code
+ * //Six axes on port B, channel A on bits 0,2,..10 and channel B on bits 1,3,..11.
+ * const uint8_t bitsA[6] = {0, 2, 4, 6, 8, 10};
+ * const uint8_t bitsB[6] = {1, 3, 5, 7, 9, 11};
+ * QEIBank<6> arm(PortB, bitsA, bitsB);
+ * int shoulder = arm[1].read();
+ * @endcode
+ */
+
+#ifndef _QEI_BANK_H_
+#define _QEI_BANK_H_
+
+#include "mbed.h"
+#include "QEIDecoder.h"
+#include "QEISpeed.h"
+
+#if DEVICE_PORTIN
+
+/**
+ * Bank of N quadrature encoders sharing one GPIO port.
+ */
+template <unsigned int N>
+class QEIBank
+{
+
+public:
+    /**
+     * View of one encoder of the bank.
+     */
+    class Axis
+    {
+
+    public:
+        /**
+         * Read the number of pulses recorded by the encoder.
+         * @return Number of pulses which have occured.
+         */
+        int read()
+        {
+            return _pulses;
+        }
+
+        /**
+         * Sets the number of pulses
+         * @param pulses Number of pulses which to set.
+         */
+        void write(int pulses)
+        {
+            _pulses = pulses;
+        }
+
+        /**
+         * Sets the factor for the getter-functions to convert in another unit.
+         * @param fSpeedFactor - factor to scale from Hz to user unit
+         */
+        void setSpeedFactor(float fSpeedFactor)
+        {
+            _fSpeedFactor = fSpeedFactor;
+        }
+
+        /**
+         * Gets the speed as float value, see QEISpeedEstimator.
+         * @return speed The value is scales by the factor set by setSpeedFactor()
+         */
+        float getSpeed()
+        {
+            _speed.sample(_timer->read_high_resolution_us());
+            return _speed.getSpeed(_fSpeedFactor);
+        }
+
+        /**
+         * Sets the factor for the getter-functions to convert in another unit.
+         * @param fPositionFactor - factor to scale from counts to user unit
+         */
+        void setPositionFactor(float fPositionFactor)
+        {
+            _fPositionFactor = fPositionFactor;
+        }
+
+        /**
+         * Gets the position as float value.
+         * @return position The value is scales by the factor set by setPositionFactor()
+         */
+        float getPosition()
+        {
+            return (float)_pulses * _fPositionFactor;
+        }
+
+    protected:
+        friend class QEIBank;
+
+        Axis() : _pulses(0), _state(0), _bitA(0), _bitB(0), _fSpeedFactor(1.0f), _fPositionFactor(1.0f), _timer(NULL)
+        {
+        }
+
+        volatile int _pulses;
+        int _state;
+        uint8_t _bitA;
+        uint8_t _bitB;
+        float _fSpeedFactor;
+        float _fPositionFactor;
+        QEISpeedEstimator _speed;
+        Timer *_timer;
+    };
+
+    /**
+     * Contructor
+     * Read the port to determine the initial states and attach the shared
+     * handler to the channel pins, channel A only for X2 encoding.
+     * 
+     * @param port mbed port of all channel pins
+     * @param bitsA bit number of channel A of each encoder within the port
+     * @param bitsB bit number of channel B of each encoder within the port
+     * @param encoding The encoding to use for all encoders.
+     */
+    QEIBank(PortName port, const uint8_t bitsA[N], const uint8_t bitsB[N], QEIDecoder::Encoding encoding = QEIDecoder::X4_ENCODING) : _port(port)
+    {
+        _transitions = QEIDecoder::transitions(encoding);
+        bool bNative = true;  //Channel A on bit 2p+1 of every encoder
+        bool bSwapped = true; //Channel A on bit 2p of every encoder
+        _packedMask = 0;
+        for (unsigned int p = 0; p < 16; p++)
+            _pairAxis[p] = 0;
+        _timer.reset();
+        _timer.start();
+
+        for (unsigned int i = 0; i < 2 * N; i++)
+            _irq[i] = NULL;
+
+        for (unsigned int i = 0; i < N; i++)
+        {
+            _axes[i]._bitA = bitsA[i];
+            _axes[i]._bitB = bitsB[i];
+            _axes[i]._timer = &_timer;
+            //X2 encoding only samples an encoder on its channel A edges, like QEI.
+            _axisMask[i] = 1UL << bitsA[i];
+            _irq[2 * i] = new InterruptIn(port_pin(port, bitsA[i]), PullUp);
+
+            if (encoding == QEIDecoder::X4_ENCODING)
+            {
+                _axisMask[i] |= 1UL << bitsB[i];
+                _irq[2 * i + 1] = new InterruptIn(port_pin(port, bitsB[i]), PullUp);
+            }
+
+            if ((bitsA[i] ^ bitsB[i]) == 1)
+            {
+                //Channel A is on the odd bit of the pair once normalised.
+                _pairAxis[bitsA[i] >> 1] = (uint8_t)i;
+                _packedMask |= 1UL << (bitsA[i] | 1);
+                if (bitsA[i] & 1)
+                    bSwapped = false;
+                else
+                    bNative = false;
+            }
+            else
+            {
+                bNative = false;
+                bSwapped = false;
+            }
+        }
+        _bPacked = (encoding == QEIDecoder::X4_ENCODING) && (bNative || bSwapped);
+        _bSwapped = !bNative;
+
+        _prevPort = (uint32_t)_port.read();
+        for (unsigned int i = 0; i < N; i++)
+            _axes[i]._state = stateOf(_axes[i], _prevPort);
+
+        for (unsigned int i = 0; i < 2 * N; i++)
+        {
+            if (_irq[i] != NULL)
+            {
+                _irq[i]->rise(callback(this, &QEIBank::update));
+                _irq[i]->fall(callback(this, &QEIBank::update));
+            }
+        }
+    }
+
+    /**
+     * Destructor
+     */
+    ~QEIBank()
+    {
+        for (unsigned int i = 0; i < 2 * N; i++)
+            delete _irq[i];
+    }
+
+    /**
+     * Gets the view of one encoder.
+     * @param i Encoder index, 0 to N-1.
+     */
+    Axis &operator[](unsigned int i)
+    {
+        return _axes[i];
+    }
+
+    /**
+     * @return Number of encoders in the bank.
+     */
+    unsigned int size() const
+    {
+        return N;
+    }
+
+protected:
+    static int stateOf(const Axis &axis, uint32_t port)
+    {
+        //2-bit state
+        return (((port >> axis._bitA) & 1) << 1) | ((port >> axis._bitB) & 1);
+    }
+
+    /**
+     * Swaps the two bits of every bit pair, 2p with 2p+1.
+     */
+    static uint32_t swapPairs(uint32_t word)
+    {
+        return ((word & 0x55555555) << 1) | ((word >> 1) & 0x55555555);
+    }
+
+    /**
+     * Called on every edge of any channel pin.
+     * Reads the port once and decodes every encoder whose sampled bits changed.
+     */
+    void update()
+    {
+        uint32_t port = (uint32_t)_port.read();
+        uint32_t prevPort = _prevPort;
+        uint32_t changed = port ^ prevPort;
+        _prevPort = port;
+
+        if (changed == 0)
+            return;
+
+        us_timestamp_t now = _timer.read_high_resolution_us();
+
+        if (_bPacked)
+        {
+            uint32_t forward, backward, invalid;
+            if (_bSwapped)
+                QEIDecoder::stepPacked(swapPairs(prevPort), swapPairs(port), forward, backward, invalid);
+            else
+                QEIDecoder::stepPacked(prevPort, port, forward, backward, invalid);
+
+            uint32_t moved = (forward | backward) & _packedMask;
+            while (moved != 0)
+            {
+                int bit = QEIDecoder::lowestBit(moved);
+                moved &= moved - 1;
+
+                Axis &axis = _axes[_pairAxis[bit >> 1]];
+                int delta = ((forward >> bit) & 1) ? 1 : -1;
+                axis._pulses += delta;
+                axis._speed.edge(delta, now);
+            }
+            return;
+        }
+
+        for (unsigned int i = 0; i < N; i++)
+        {
+            if ((changed & _axisMask[i]) == 0)
+                continue;
+
+            Axis &axis = _axes[i];
+            int state = stateOf(axis, port);
+            const QEIDecoder::Transition transition = _transitions[(axis._state << 2) | state];
+            axis._state = state;
+
+            if (transition.delta != 0)
+            {
+                axis._pulses += transition.delta;
+                axis._speed.edge(transition.delta, now);
+            }
+        }
+    }
+
+    PortIn _port;
+    InterruptIn *_irq[2 * N];
+    const QEIDecoder::Transition *_transitions;
+    uint32_t _prevPort;
+    uint32_t _axisMask[N];
+    bool _bPacked;         //Decode with QEIDecoder::stepPacked()
+    bool _bSwapped;        //Swap the bits of each pair before stepPacked()
+    uint32_t _packedMask;  //Channel A bits of all encoders, normalised to the odd bits
+    uint8_t _pairAxis[16]; //Encoder on each bit pair
+    Axis _axes[N];
+    Timer _timer;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,230 @@
+#include "QEICapture.h"
+
+#if defined(TARGET_STM)
+
+#include "pinmap.h"
+#include "PeripheralPins.h"
+
+QEICapture *QEICapture::_instances[QEI_CAPTURE_TIMERS];
+
+template <int N>
+void QEICapture::handler()
+{
+    _instances[N]->irq();
+}
+
+//Slot, interrupt and clock of the supported timers, all on APB1.
+static int enableTimer(TIM_TypeDef *tim, IRQn_Type &irq)
+{
+#if defined(TIM2)
+    if (tim == TIM2)
+    {
+        __HAL_RCC_TIM2_CLK_ENABLE();
+        irq = TIM2_IRQn;
+        return 0;
+    }
+#endif
+#if defined(TIM3)
+    if (tim == TIM3)
+    {
+        __HAL_RCC_TIM3_CLK_ENABLE();
+        irq = TIM3_IRQn;
+        return 1;
+    }
+#endif
+#if defined(TIM4)
+    if (tim == TIM4)
+    {
+        __HAL_RCC_TIM4_CLK_ENABLE();
+        irq = TIM4_IRQn;
+        return 2;
+    }
+#endif
+#if defined(TIM5)
+    if (tim == TIM5)
+    {
+        __HAL_RCC_TIM5_CLK_ENABLE();
+        irq = TIM5_IRQn;
+        return 3;
+    }
+#endif
+    return -1;
+}
+
+//APB1 timers run at twice PCLK1 when the APB1 bus is divided.
+static uint32_t timerClock()
+{
+    RCC_ClkInitTypeDef clkConfig;
+    uint32_t flashLatency;
+
+    HAL_RCC_GetClockConfig(&clkConfig, &flashLatency);
+    uint32_t clock = HAL_RCC_GetPCLK1Freq();
+    if (clkConfig.APB1CLKDivider != RCC_HCLK_DIV1)
+        clock *= 2;
+    return clock;
+}
+
+QEICapture::QEICapture(PinName channelA, PinName channelB, PinName index, Encoding encoding, int nFilter) : QEIBase(NC, NC, index, encoding)
+{
+    //Both pins must belong to the same timer, on channels 1 and 2.
+    uint32_t timA = pinmap_peripheral(channelA, PinMap_PWM);
+    uint32_t functionA = pinmap_function(channelA, PinMap_PWM);
+    uint32_t functionB = pinmap_function(channelB, PinMap_PWM);
+    MBED_ASSERT(pinmap_peripheral(channelB, PinMap_PWM) == timA);
+    MBED_ASSERT(STM_PIN_CHANNEL(functionA) == 1 && STM_PIN_CHANNEL(functionB) == 2);
+
+    _tim = (TIM_TypeDef *)(uintptr_t)timA;
+    _nSlot = enableTimer(_tim, _irq);
+    MBED_ASSERT(_nSlot >= 0 && _instances[_nSlot] == NULL);
+
+    pin_function(channelA, functionA);
+    pin_function(channelB, functionB);
+    pin_mode(channelA, PullUp);
+    pin_mode(channelB, PullUp);
+    gpio_init(&_gpioA, channelA);
+    gpio_init(&_gpioB, channelB);
+
+    uint32_t filter = (uint32_t)nFilter & 0x0F;
+
+    _tim->CR1 = 0;
+    _tim->SMCR = 0;
+    _tim->DIER = 0;
+    _tim->PSC = 0;
+
+    //16-bit timers ignore the upper half of ARR.
+    _tim->ARR = 0xFFFFFFFF;
+    _nPeriod = (uint64_t)_tim->ARR + 1;
+    _nTicksHigh = 0;
+
+    //TI1 and TI2 captured on themselves, with the input filter, on both edges.
+    _tim->CCMR1 = TIM_CCMR1_CC1S_0 | TIM_CCMR1_CC2S_0 | (filter << TIM_CCMR1_IC1F_Pos) | (filter << TIM_CCMR1_IC2F_Pos);
+    if (encoding == X4_ENCODING)
+        _tim->CCER = TIM_CCER_CC1E | TIM_CCER_CC1P | TIM_CCER_CC1NP | TIM_CCER_CC2E | TIM_CCER_CC2P | TIM_CCER_CC2NP;
+    else
+        _tim->CCER = TIM_CCER_CC1E | TIM_CCER_CC1P | TIM_CCER_CC1NP;
+
+    _tim->EGR = TIM_EGR_UG;
+    _tim->CNT = 0;
+    _tim->SR = 0;
+
+    setTimebase(timerClock());
+
+    //2-bit state
+    _currState = (gpio_read(&_gpioA) << 1) | gpio_read(&_gpioB);
+    _prevState = _currState;
+    _nChannelState = _currState;
+
+    static const uintptr_t handlers[QEI_CAPTURE_TIMERS] = {(uintptr_t)&handler<0>, (uintptr_t)&handler<1>, (uintptr_t)&handler<2>, (uintptr_t)&handler<3>};
+    _instances[_nSlot] = this;
+    NVIC_SetVector(_irq, handlers[_nSlot]);
+    NVIC_EnableIRQ(_irq);
+
+    _tim->DIER = TIM_DIER_UIE | TIM_DIER_CC1IE | ((encoding == X4_ENCODING) ? TIM_DIER_CC2IE : 0);
+    _tim->CR1 = TIM_CR1_CEN;
+}
+
+QEICapture::~QEICapture()
+{
+    _tim->DIER = 0;
+    _tim->CR1 &= ~TIM_CR1_CEN;
+    NVIC_DisableIRQ(_irq);
+    _instances[_nSlot] = NULL;
+}
+
+us_timestamp_t QEICapture::now()
+{
+    uint64_t high;
+    uint32_t count;
+
+    __disable_irq();
+    high = _nTicksHigh;
+    count = _tim->CNT;
+    //Wrapped but the overflow interrupt has not run yet.
+    if ((_tim->SR & TIM_SR_UIF) && count < _nPeriod / 2)
+        high += _nPeriod;
+    __enable_irq();
+
+    return high + count;
+}
+
+void QEICapture::irq()
+{
+    //Reading CCRx clears CCxIF, so only read the channels flagged here: a
+    //capture after this read keeps its flag and interrupt. The overflow flag
+    //is read after the captures, so a capture taken after a wrap always sees
+    //that wrap.
+    uint32_t captured = _tim->SR;
+    bool edgeA = (captured & TIM_SR_CC1IF) != 0;
+    bool edgeB = (captured & TIM_SR_CC2IF) != 0;
+    uint32_t captureA = edgeA ? (uint32_t)_tim->CCR1 : 0;
+    uint32_t captureB = edgeB ? (uint32_t)_tim->CCR2 : 0;
+    uint32_t flags = _tim->SR;
+    uint32_t overflow = flags & TIM_SR_UIF;
+    uint32_t overcapture = flags & (TIM_SR_CC1OF | TIM_SR_CC2OF);
+
+    //The flags are rc_w0, only clear the ones handled here.
+    _tim->SR = ~(overflow | overcapture);
+
+    uint64_t high = _nTicksHigh;
+
+    //A capture in the lower half with an overflow pending was taken after the wrap.
+    uint64_t timeA = high + captureA + ((overflow && captureA < _nPeriod / 2) ? _nPeriod : 0);
+    uint64_t timeB = high + captureB + ((overflow && captureB < _nPeriod / 2) ? _nPeriod : 0);
+
+    if (overflow)
+        _nTicksHigh = high + _nPeriod;
+
+    //Each capture is one edge of its channel. The pins are not re-read, they
+    //may already show an edge whose capture is still pending.
+    int stateA = edgeA ? (_nChannelState ^ 2) : _nChannelState;
+    int stateB = edgeB ? (_nChannelState ^ 1) : _nChannelState;
+
+    //X2 does not capture channel B, it is stable at an A edge so read it.
+    if (_encoding != X4_ENCODING && edgeA)
+        stateA = (stateA & 2) | gpio_read(&_gpioB);
+
+    //An overwritten capture lost an edge of that channel, take its level from the pin.
+    if (overcapture)
+    {
+        if (overcapture & TIM_SR_CC1OF)
+        {
+            _nLostCaptures++;
+            stateA = (stateA & 1) | (gpio_read(&_gpioA) << 1);
+        }
+        if (overcapture & TIM_SR_CC2OF)
+        {
+            _nLostCaptures++;
+            stateB = (stateB & 2) | gpio_read(&_gpioB);
+        }
+    }
+
+    if (edgeA && edgeB)
+    {
+        //Both channels moved since the last interrupt, decode the earlier
+        //edge first with the later channel still at its previous level.
+        int state = (stateA & 2) | (stateB & 1);
+        if (timeA <= timeB)
+        {
+            process(stateA, timeA);
+            process(state, timeB);
+        }
+        else
+        {
+            process(stateB, timeB);
+            process(state, timeA);
+        }
+        _nChannelState = state;
+    }
+    else if (edgeA)
+    {
+        process(stateA, timeA);
+        _nChannelState = stateA;
+    }
+    else if (edgeB)
+    {
+        process(stateB, timeB);
+        _nChannelState = stateB;
+    }
+}
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * Quadrature Encoder Interface timestamped by STM32 timer input capture.
+ *
+ * Channel A and B are captured on both edges by channel 1 and 2 of a free
+ * running timer. The hardware latches the counter at the edge, so the edge
+ * times have the resolution of the timer clock and include neither the
+ * interrupt latency nor a call into the mbed ticker layer. The capture
+ * interrupt reads the latched times and the pin levels and hands them to the
+ * same decoder as QEI, with the timer clock as timebase. The channel levels
+ * follow from the captures themselves, one edge each; a capture overwritten
+ * before the interrupt read it is counted in QEIDiagnostics::lostCaptures.
+ * X2 only captures channel A and reads channel B from the pin at each edge.
+ *
+ * Channel A must be wired to channel 1 and channel B to channel 2 of TIM2,
+ * TIM3, TIM4 or TIM5, as listed in the target's PinMap_PWM, and the timer
+ * must not be the one used by the target's us_ticker. 32-bit timers (TIM2
+ * and TIM5 on most families) overflow least often. The interrupt latency
+ * must stay below half a timer period to extend the count correctly.
+ *
+ * The timer input filter replaces the software glitch filter, which re-reads
+ * the pins: use setGlitchFilter(1, nMinPulseWidth) at most.
+ */
+
+#ifndef _QEI_CAPTURE_H_
+#define _QEI_CAPTURE_H_
+
+#include "mbed.h"
+#include "QEI.h"
+
+#if defined(TARGET_STM)
+
+#include "gpio_api.h"
+
+#define QEI_CAPTURE_TIMERS 4 //TIM2 to TIM5
+
+/**
+ * Quadrature Encoder Interface timestamped by STM32 timer input capture.
+ */
+class QEICapture : public QEIBase
+{
+
+public:
+    /**
+     * Contructor
+     * Configures the timer of the two pins for input capture on both edges
+     * and starts it.
+     * 
+     * @param channelA mbed pin for channel A input, timer channel 1
+     * @param channelB mbed pin for channel B input, timer channel 2
+     * @param index mbed pin for optional index channel input, (pass NC if not needed).
+     * @param encoding The encoding to use. X2 only captures channel A.
+     * @param nFilter Timer input filter, 0 (off) to 15, see ICxF in the reference manual.
+     */
+    QEICapture(PinName channelA, PinName channelB, PinName index, Encoding encoding = X4_ENCODING, int nFilter = 0);
+
+    /**
+     * Destructor
+     * Stops the timer and its interrupt.
+     */
+    virtual ~QEICapture();
+
+protected:
+    /**
+     * Capture and overflow interrupt.
+     */
+    void irq();
+
+    template <int N>
+    static void handler();
+
+    /**
+     * @return The extended timer count, in timer clock ticks.
+     */
+    virtual us_timestamp_t now();
+
+    static QEICapture *_instances[QEI_CAPTURE_TIMERS];
+
+    TIM_TypeDef *_tim;
+    IRQn_Type _irq;
+    int _nSlot;
+
+    gpio_t _gpioA; //Pin levels, read through the GPIO while the pins are in timer mode
+    gpio_t _gpioB;
+    int _nChannelState; //(A << 1) | B after the captures handled so far
+
+    uint64_t _nPeriod;             //Timer counts per overflow, 2^16 or 2^32
+    volatile uint64_t _nTicksHigh; //Ticks of the overflows so far
+};
+
+#endif
+
+#endif
@@ -0,0 +1,307 @@
+#include "QEICompare.h"
+
+QEICompare::QEICompare()
+{
+    _targets = NULL;
+    _nTargets = 0;
+    _flags = NULL;
+    _events = NULL;
+    _bOutput = false;
+    _nOutputLevel = 0;
+    _nHysteresis = 1;
+    _nRearm = 0;
+    _nRearmCount = 0;
+    arm(0);
+}
+
+void QEICompare::setTargets(const QEICompareTarget *targets, unsigned int nTargets)
+{
+    _targets = targets;
+    _nTargets = (int)nTargets;
+}
+
+void QEICompare::setCallback(Callback<void(unsigned int)> callback)
+{
+    _callback = callback;
+}
+
+void QEICompare::setEventFlags(EventFlags *flags)
+{
+    _flags = flags;
+}
+
+void QEICompare::setEvents(QEIEvents *events)
+{
+    _events = events;
+}
+
+void QEICompare::setHysteresis(int64_t nCounts)
+{
+    __disable_irq();
+    _nHysteresis = (nCounts > 0) ? nCounts : 1;
+    __enable_irq();
+}
+
+void QEICompare::setOutput(PinName output)
+{
+    _bOutput = false;
+    _nOutputLevel = 0;
+    if (output != NC)
+    {
+        gpio_init_out_ex(&_output, output, 0);
+        _bOutput = true;
+    }
+}
+
+unsigned int QEICompare::getPending()
+{
+    unsigned int pending;
+
+    __disable_irq();
+    pending = (unsigned int)(_nTargets - _nAboveIndex + _nBelowIndex + 1);
+    __enable_irq();
+
+    return pending;
+}
+
+void QEICompare::arm(int64_t count)
+{
+    //Binary search for the first target above the count.
+    int low = 0;
+    int high = _nTargets;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (_targets[middle].count > count)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+
+    _nAboveIndex = low;
+    _nBelowIndex = low - 1;
+    if (_nBelowIndex >= 0 && _targets[_nBelowIndex].count == count)
+        _nBelowIndex--;
+
+    updateBounds();
+}
+
+void QEICompare::advance(int64_t count, bool fire)
+{
+    //One target per edge, more only after a jump.
+    while (_nAboveIndex < _nTargets && _targets[_nAboveIndex].count <= count)
+    {
+        if (fire)
+            signal((unsigned int)_nAboveIndex, _targets[_nAboveIndex].flags);
+        _nAboveIndex++;
+    }
+
+    while (_nBelowIndex >= 0 && _targets[_nBelowIndex].count >= count)
+    {
+        if (fire)
+            signal((unsigned int)_nBelowIndex, _targets[_nBelowIndex].flags);
+        _nBelowIndex--;
+    }
+
+    updateBounds();
+}
+
+void QEICompare::updateBounds()
+{
+    _nAbove = (_nAboveIndex < _nTargets) ? _targets[_nAboveIndex].count : INT64_MAX;
+    _nBelow = (_nBelowIndex >= 0) ? _targets[_nBelowIndex].count : INT64_MIN;
+}
+
+QEICompareSequence::QEICompareSequence(int64_t nStart, int64_t nStep, uint32_t nFlags)
+{
+    _nStart = nStart;
+    _nStep = (nStep > 0) ? nStep : 1;
+    _nFlags = nFlags;
+    arm(0);
+}
+
+void QEICompareSequence::arm(int64_t count)
+{
+    //Floored number of the target at or below the count.
+    int64_t offset = count - _nStart;
+    int64_t target = offset / _nStep;
+    if (offset - target * _nStep < 0)
+        target--;
+
+    _nBelowTarget = target;
+    _nAboveTarget = target + 1;
+    _nBelowCount = _nStart + target * _nStep;
+
+    //A target at the count is not fired, arm the one below it instead.
+    if (_nBelowCount == count)
+    {
+        _nBelowTarget--;
+        _nBelowCount -= _nStep;
+    }
+    _nAboveCount = _nStart + _nAboveTarget * _nStep;
+
+    _nRearm = 0;
+    setBounds(_nAboveCount, _nBelowCount);
+}
+
+void QEICompareSequence::advance(int64_t count, bool fire)
+{
+    if (count == _nAboveCount)
+    {
+        if (fire)
+            signal((unsigned int)_nAboveTarget, _nFlags);
+        //The neighbours now, the fired target once the count is _nHysteresis past it.
+        _nRearm = 1;
+        _nRearmCount = count + _nHysteresis;
+        _nBelowTarget = _nAboveTarget - 1;
+        _nBelowCount = _nAboveCount - _nStep;
+        _nAboveTarget++;
+        _nAboveCount += _nStep;
+    }
+    else if (count == _nBelowCount)
+    {
+        if (fire)
+            signal((unsigned int)_nBelowTarget, _nFlags);
+        _nRearm = -1;
+        _nRearmCount = count - _nHysteresis;
+        _nAboveTarget = _nBelowTarget + 1;
+        _nAboveCount = _nBelowCount + _nStep;
+        _nBelowTarget--;
+        _nBelowCount -= _nStep;
+    }
+    else if (_nRearm > 0 && count == _nRearmCount)
+    {
+        _nBelowTarget = _nAboveTarget - 1;
+        _nBelowCount = _nAboveCount - _nStep;
+        _nRearm = 0;
+    }
+    else if (_nRearm < 0 && count == _nRearmCount)
+    {
+        _nAboveTarget = _nBelowTarget + 1;
+        _nAboveCount = _nBelowCount + _nStep;
+        _nRearm = 0;
+    }
+    else
+    {
+        //Jumped past a target, re-arm without firing.
+        arm(count);
+        return;
+    }
+
+    setBounds(_nAboveCount, _nBelowCount);
+}
+
+QEICompareRepeating::QEICompareRepeating(int64_t nPeriod)
+{
+    _nPeriod = (nPeriod > 0) ? nPeriod : 1;
+    arm(0);
+}
+
+unsigned int QEICompareRepeating::getPending()
+{
+    return (unsigned int)_nTargets;
+}
+
+void QEICompareRepeating::next(int &index, int64_t &offset)
+{
+    if (++index == _nTargets)
+    {
+        index = 0;
+        offset += _nPeriod;
+    }
+}
+
+void QEICompareRepeating::previous(int &index, int64_t &offset)
+{
+    if (--index < 0)
+    {
+        index = _nTargets - 1;
+        offset -= _nPeriod;
+    }
+}
+
+void QEICompareRepeating::arm(int64_t count)
+{
+    _nRearm = 0;
+    if (_nTargets == 0)
+    {
+        QEICompare::arm(count);
+        return;
+    }
+    MBED_ASSERT(_targets[_nTargets - 1].count - _targets[0].count < _nPeriod);
+
+    //Floored repetition of the count, then the table search in that repetition.
+    int64_t offset = count - _targets[0].count;
+    int64_t repetition = offset / _nPeriod;
+    if (offset - repetition * _nPeriod < 0)
+        repetition--;
+    int64_t base = repetition * _nPeriod;
+    QEICompare::arm(count - base);
+
+    _nAboveOffset = base;
+    if (_nAboveIndex == _nTargets)
+    {
+        _nAboveIndex = 0;
+        _nAboveOffset += _nPeriod;
+    }
+    _nBelowOffset = base;
+    if (_nBelowIndex < 0)
+    {
+        _nBelowIndex += _nTargets;
+        _nBelowOffset -= _nPeriod;
+    }
+
+    setBounds(countOf(_nAboveIndex, _nAboveOffset), countOf(_nBelowIndex, _nBelowOffset));
+}
+
+void QEICompareRepeating::advance(int64_t count, bool fire)
+{
+    if (_nTargets == 0)
+        return;
+
+    if (count == countOf(_nAboveIndex, _nAboveOffset))
+    {
+        if (fire)
+            signal((unsigned int)_nAboveIndex, _targets[_nAboveIndex].flags);
+        //The entries before and after the fired one, itself once the count is _nHysteresis past it.
+        _nRearm = 1;
+        _nRearmCount = count + _nHysteresis;
+        _nBelowIndex = _nAboveIndex;
+        _nBelowOffset = _nAboveOffset;
+        previous(_nBelowIndex, _nBelowOffset);
+        next(_nAboveIndex, _nAboveOffset);
+    }
+    else if (count == countOf(_nBelowIndex, _nBelowOffset))
+    {
+        if (fire)
+            signal((unsigned int)_nBelowIndex, _targets[_nBelowIndex].flags);
+        _nRearm = -1;
+        _nRearmCount = count - _nHysteresis;
+        _nAboveIndex = _nBelowIndex;
+        _nAboveOffset = _nBelowOffset;
+        next(_nAboveIndex, _nAboveOffset);
+        previous(_nBelowIndex, _nBelowOffset);
+    }
+    else if (_nRearm > 0 && count == _nRearmCount)
+    {
+        _nBelowIndex = _nAboveIndex;
+        _nBelowOffset = _nAboveOffset;
+        previous(_nBelowIndex, _nBelowOffset);
+        _nRearm = 0;
+    }
+    else if (_nRearm < 0 && count == _nRearmCount)
+    {
+        _nAboveIndex = _nBelowIndex;
+        _nAboveOffset = _nBelowOffset;
+        next(_nAboveIndex, _nAboveOffset);
+        _nRearm = 0;
+    }
+    else
+    {
+        //Jumped past a target, re-arm without firing.
+        arm(count);
+        return;
+    }
+
+    setBounds(countOf(_nAboveIndex, _nAboveOffset), countOf(_nBelowIndex, _nBelowOffset));
+}
@@ -0,0 +1,290 @@
+/**
+ * Position compare for the Quadrature Encoder Interface.
+ *
+ * Holds an ascending table of target counts. The encoder checks every count
+ * change against the nearest pending target above and below the count, two
+ * compares per edge whatever the size of the table. A target fires once,
+ * from the edge interrupt, on the edge which reaches it from either side,
+ * by calling the callback and setting its EventFlags.
+ *
+ * The count moves one pulse per edge, so the targets passed since arming
+ * are always one contiguous run of the table: the pending targets are the
+ * ones before and after it. A jump of the count by write(), reset() or the
+ * index modes drops the targets it jumps over without firing them.
+ *
+ * QEICompareSequence replaces the table by an arithmetic sequence of
+ * targets every nStep counts, for periodic triggers, and QEICompareRepeating
+ * repeats the table every nPeriod counts. Any of them can toggle an output
+ * pin as the first action of a fired target, a few cycles after the count
+ * change.
+ *
+ * @code
+ * static const QEICompareTarget targets[] = {{1000, 0x1}, {2000, 0x2}};
+ * QEICompare compare;
+ * compare.setTargets(targets, 2);
+ * compare.setEventFlags(&flags);
+ * encoder.setCompare(&compare);
+ * flags.wait_any(0x3);
+ * @endcode
+ */
+
+#ifndef _QEI_COMPARE_H_
+#define _QEI_COMPARE_H_
+
+#include "mbed.h"
+#include "gpio_api.h"
+#include "QEIEvents.h"
+
+/**
+ * One compare target.
+ */
+typedef struct QEICompareTarget
+{
+    int64_t count;  //Pulse count to fire at, the table is strictly ascending
+    uint32_t flags; //EventFlags to set when fired, 0 for none
+} QEICompareTarget;
+
+/**
+ * Position compare table.
+ */
+class QEICompare
+{
+
+public:
+    /**
+     * Contructor
+     * Starts without targets.
+     */
+    QEICompare();
+
+    virtual ~QEICompare() {}
+
+    /**
+     * Sets the target table, kept by reference.
+     * Takes effect when the compare is attached with QEIBase::setCompare(),
+     * attach it again to re-arm after changing the table.
+     * @param targets Targets in strictly ascending count order.
+     * @param nTargets Number of targets.
+     */
+    void setTargets(const QEICompareTarget *targets, unsigned int nTargets);
+
+    /**
+     * Sets the function called from the edge interrupt when a target fires.
+     * @param callback Called with the index of the target in the table.
+     */
+    void setCallback(Callback<void(unsigned int)> callback);
+
+    /**
+     * Sets the EventFlags the target flags are set on.
+     * @param flags EventFlags to signal, NULL for none.
+     */
+    void setEventFlags(EventFlags *flags);
+
+    /**
+     * Sets the events a THRESHOLD_EVENT is posted to when a target fires.
+     * @param events Events to post to, NULL for none.
+     */
+    void setEvents(QEIEvents *events);
+
+    /**
+     * Sets how far the count must move past a fired target before it can
+     * fire again, for QEICompareSequence and QEICompareRepeating. Table
+     * targets of QEICompare fire once.
+     * @param nCounts Counts past the target, at least 1, 1 by default.
+     */
+    void setHysteresis(int64_t nCounts);
+
+    /**
+     * Sets a pin toggled by every fired target, before the flags and the callback.
+     * @param output mbed pin to toggle, starting low, NC for none.
+     */
+    void setOutput(PinName output);
+
+    /**
+     * @return Number of table targets not fired yet.
+     */
+    virtual unsigned int getPending();
+
+    /**
+     * Arm all targets except the ones at the count. Called by QEIBase::setCompare().
+     * @param count Current pulse count.
+     */
+    virtual void arm(int64_t count);
+
+    /**
+     * Follow a jump of the count, dropping the targets jumped over.
+     * @param count New pulse count.
+     */
+    void seek(int64_t count)
+    {
+        if (count >= _nAbove || count <= _nBelow)
+            advance(count, false);
+    }
+
+    /**
+     * Fire the targets reached by a count change. Called from the edge interrupt.
+     * @param count New pulse count.
+     */
+    void check(int64_t count)
+    {
+        if (count >= _nAbove || count <= _nBelow)
+            advance(count, true);
+    }
+
+protected:
+    /**
+     * Move the pending bounds past the targets reached by count.
+     */
+    virtual void advance(int64_t count, bool fire);
+
+    /**
+     * Toggle the output, set the flags and call the callback of a target.
+     */
+    void signal(unsigned int index, uint32_t flags)
+    {
+        if (_bOutput)
+            gpio_write(&_output, _nOutputLevel ^= 1);
+        if (_flags != NULL && flags != 0)
+            _flags->set(flags);
+        if (_callback)
+            _callback(index);
+        if (_events != NULL)
+            _events->post(QEIEvents::THRESHOLD_EVENT);
+    }
+
+    /**
+     * Update _nAbove/_nBelow from the pending indices.
+     */
+    void updateBounds();
+
+    /**
+     * Set _nAbove/_nBelow to the pending target counts, or to the re-arm
+     * point of a fired target if that comes first.
+     */
+    void setBounds(int64_t above, int64_t below)
+    {
+        _nAbove = (_nRearm > 0 && _nRearmCount < above) ? _nRearmCount : above;
+        _nBelow = (_nRearm < 0 && _nRearmCount > below) ? _nRearmCount : below;
+    }
+
+    const QEICompareTarget *_targets;
+    int _nTargets;
+    int _nAboveIndex; //First pending target above the count, _nTargets if none
+    int _nBelowIndex; //Last pending target below the count, -1 if none
+    int64_t _nAbove;  //Their counts, or the int64_t limits
+    int64_t _nBelow;
+
+    int64_t _nHysteresis;
+    int _nRearm;          //+1 or -1 after a target fired moving up or down, until the count reaches _nRearmCount
+    int64_t _nRearmCount; //Fired target plus or minus _nHysteresis
+
+    Callback<void(unsigned int)> _callback;
+    EventFlags *_flags;
+    QEIEvents *_events;
+
+    gpio_t _output;
+    bool _bOutput;
+    int _nOutputLevel;
+};
+
+/**
+ * Position compare at every nStep counts from nStart, in both directions.
+ *
+ * The callback gets the number k of the target at nStart + k * nStep, cast
+ * to unsigned. A fired target arms its neighbours at one step on either
+ * side, and itself again once the count moved setHysteresis() counts past
+ * it: jitter around a target on the side it was reached from fires it once.
+ * Re-arming is an add per fired target.
+ */
+class QEICompareSequence : public QEICompare
+{
+
+public:
+    /**
+     * Contructor
+     * @param nStart Count of target 0.
+     * @param nStep Counts between targets, greater than 0.
+     * @param nFlags EventFlags to set on every target, 0 for none.
+     */
+    QEICompareSequence(int64_t nStart, int64_t nStep, uint32_t nFlags = 0);
+
+    /**
+     * Arm the targets next to the count. Called by QEIBase::setCompare().
+     * @param count Current pulse count.
+     */
+    virtual void arm(int64_t count);
+
+protected:
+    virtual void advance(int64_t count, bool fire);
+
+    int64_t _nStart;
+    int64_t _nStep;
+    uint32_t _nFlags;
+    int64_t _nAboveTarget; //Numbers of the pending targets
+    int64_t _nBelowTarget;
+    int64_t _nAboveCount;  //Their counts
+    int64_t _nBelowCount;
+};
+
+/**
+ * Position compare table repeated every nPeriod counts, in both directions.
+ *
+ * Target i of the table fires at targets[i].count + k * nPeriod for every
+ * k, the callback gets i. The table must span less than nPeriod counts. As
+ * with QEICompareSequence, a fired target arms its neighbours in the
+ * repeated table, a step to the next or previous entry, and itself again
+ * once the count moved setHysteresis() counts past it, so re-arming needs
+ * no search. The targets are never used up.
+ *
+ * @code
+ * //Strobe 250 and 700 counts into every 1000 count revolution.
+ * static const QEICompareTarget targets[] = {{250, 0x1}, {700, 0x2}};
+ * QEICompareRepeating compare(1000);
+ * compare.setTargets(targets, 2);
+ * encoder.setCompare(&compare);
+ * @endcode
+ */
+class QEICompareRepeating : public QEICompare
+{
+
+public:
+    /**
+     * Contructor
+     * @param nPeriod Counts between repetitions of the table, greater than 0.
+     */
+    QEICompareRepeating(int64_t nPeriod);
+
+    /**
+     * @return Number of table targets, they are never used up.
+     */
+    virtual unsigned int getPending();
+
+    /**
+     * Arm the targets next to the count. Called by QEIBase::setCompare().
+     * @param count Current pulse count.
+     */
+    virtual void arm(int64_t count);
+
+protected:
+    virtual void advance(int64_t count, bool fire);
+
+    /**
+     * Step a table index and its offset to the next or previous repeated entry.
+     */
+    void next(int &index, int64_t &offset);
+    void previous(int &index, int64_t &offset);
+
+    /**
+     * @return Count of a repeated entry.
+     */
+    int64_t countOf(int index, int64_t offset)
+    {
+        return _targets[index].count + offset;
+    }
+
+    int64_t _nPeriod;
+    int64_t _nAboveOffset; //Repetitions times nPeriod of the targets at _nAboveIndex and _nBelowIndex
+    int64_t _nBelowOffset;
+};
+
+#endif
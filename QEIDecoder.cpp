@@ -0,0 +1,81 @@
+#include "QEIDecoder.h"
+
+// +-------------+
+// | X2 Encoding |
+// +-------------+
+//
+// When observing states two patterns will appear:
+//
+// Counter clockwise rotation:
+//
+// 10 -> 01 -> 10 -> 01 -> ...
+//
+// Clockwise rotation:
+//
+// 11 -> 00 -> 11 -> 00 -> ...
+//
+// We consider counter clockwise rotation to be "forward" and
+// counter clockwise to be "backward". Therefore pulse count will increase
+// during counter clockwise rotation and decrease during clockwise rotation.
+//
+// +-------------+
+// | X4 Encoding |
+// +-------------+
+//
+// There are four possible states for a quadrature encoder which correspond to
+// 2-bit gray code.
+//
+// A state change is only valid if of only one bit has changed.
+// A state change is invalid if both bits have changed.
+//
+// Clockwise Rotation ->
+//
+//    00 01 11 10 00
+//
+// <- Counter Clockwise Rotation
+//
+// If we observe any valid state changes going from left to right, we have
+// moved one pulse clockwise [we will consider this "backward" or "negative"].
+//
+// If we observe any valid state changes going from right to left we have
+// moved one pulse counter clockwise [we will consider this "forward" or
+// "positive"].
+//
+// We might enter an invalid state for a number of reasons which are hard to
+// predict - if this is the case, it is generally safe to ignore it, update
+// the state and carry on, with the error correcting itself shortly after.
+
+// Both encodings are decoded with a 16 entry table indexed by
+// (previous state << 2) | current state, so step() needs a single load
+// instead of comparing states on every edge.
+
+//X2 encoding: 11->00 and 00->10 are "forward", 10->01 and 01->10 are "backward".
+//Only channel A interrupts, so both bits changing is the normal case here.
+const QEIDecoder::Transition QEIDecoder::_X2Transitions[16] = {
+    //prev 00 -> curr 00, 01, 10, 11
+    {0, 0}, {0, 0}, {+1, 0}, {0, 0},
+    //prev 01 -> curr 00, 01, 10, 11
+    {0, 0}, {0, 0}, {-1, 0}, {0, 0},
+    //prev 10 -> curr 00, 01, 10, 11
+    {0, 0}, {-1, 0}, {0, 0}, {0, 0},
+    //prev 11 -> curr 00, 01, 10, 11
+    {+1, 0}, {0, 0}, {0, 0}, {0, 0},
+};
+
+//X4 encoding: 00->01->11->10->00 is "forward", the reverse is "backward".
+//A change of both bits is invalid and leaves the count untouched.
+const QEIDecoder::Transition QEIDecoder::_X4Transitions[16] = {
+    //prev 00 -> curr 00, 01, 10, 11
+    {0, 0}, {+1, 0}, {-1, 0}, {0, 1},
+    //prev 01 -> curr 00, 01, 10, 11
+    {-1, 0}, {0, 0}, {0, 1}, {+1, 0},
+    //prev 10 -> curr 00, 01, 10, 11
+    {+1, 0}, {0, 1}, {0, 0}, {-1, 0},
+    //prev 11 -> curr 00, 01, 10, 11
+    {0, 1}, {-1, 0}, {+1, 0}, {0, 0},
+};
+
+const QEIDecoder::Transition *QEIDecoder::transitions(Encoding encoding)
+{
+    return (encoding == X4_ENCODING) ? _X4Transitions : _X2Transitions;
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+/**
+ * Quadrature state decoder.
+ *
+ * Turns a sequence of 2-bit channel states ((A << 1) | B) into pulse deltas.
+ * It only depends on <stdint.h>, so the decoding can be compiled and fed
+ * recorded or synthetic state sequences without the mbed HAL.
+ */
+
+#ifndef _QEI_DECODER_H_
+#define _QEI_DECODER_H_
+
+#include <stdint.h>
+
+/**
+ * Quadrature state decoder.
+ */
+class QEIDecoder
+{
+
+public:
+    typedef enum Encoding
+    {
+        X2_ENCODING,
+        X4_ENCODING
+    } Encoding;
+
+    /**
+     * Result of decoding a (previous, current) 2-bit state pair.
+     */
+    typedef struct Transition
+    {
+        int8_t delta;    //Pulse change: -1, 0 or +1
+        uint8_t invalid; //Non-zero if both channels changed between samples
+    } Transition;
+
+    /**
+     * Contructor
+     * @param state Initial 2-bit state of the channels.
+     */
+    QEIDecoder(int state = 0)
+    {
+        _currState = state & 0x03;
+        _prevState = _currState;
+    }
+
+    /**
+     * Decode the next state with the encoding fixed at compile time.
+     * @param state New 2-bit state of the channels.
+     * @return Transition from the previous state to this one.
+     */
+    template <Encoding E>
+    Transition step(int state)
+    {
+        _currState = state & 0x03;
+        const Transition transition = (E == X4_ENCODING ? _X4Transitions : _X2Transitions)[(_prevState << 2) | _currState];
+        _prevState = _currState;
+        return transition;
+    }
+
+    /**
+     * Decode the next state with the encoding chosen at run time.
+     * @param encoding The encoding to use.
+     * @param state New 2-bit state of the channels.
+     * @return Transition from the previous state to this one.
+     */
+    Transition step(Encoding encoding, int state)
+    {
+        _currState = state & 0x03;
+        const Transition transition = transitions(encoding)[(_prevState << 2) | _currState];
+        _prevState = _currState;
+        return transition;
+    }
+
+    /**
+     * Decode up to 16 encoders at once from two port samples, X4 encoding.
+     * 
+     * Encoder i uses bit 2i+1 for channel A and bit 2i for channel B, so each
+     * bit pair holds its 2-bit state (A << 1) | B. Bit 2i+1 of each result
+     * mask is set if encoder i moved forward, backward or changed both bits,
+     * bit 2i is always clear. Same results as 16 lookups in the X4 table.
+     * @param prev Previous port sample.
+     * @param curr Current port sample.
+     * @param forward Set to the encoders which counted +1.
+     * @param backward Set to the encoders which counted -1.
+     * @param invalid Set to the encoders where both channels changed.
+     */
+    static void stepPacked(uint32_t prev, uint32_t curr, uint32_t &forward, uint32_t &backward, uint32_t &invalid)
+    {
+        const uint32_t maskA = 0xAAAAAAAA;
+        uint32_t changed = prev ^ curr;
+        uint32_t changedA = changed & maskA;
+        uint32_t changedB = (changed << 1) & maskA;
+
+        //Forward when the previous B equals the current A, see the X4 table.
+        uint32_t reverse = ((prev << 1) ^ curr) & maskA;
+        uint32_t valid = changedA ^ changedB;
+
+        forward = valid & ~reverse;
+        backward = valid & reverse;
+        invalid = changedA & changedB;
+    }
+
+    /**
+     * Gets the index of the lowest set bit.
+     * @param mask Non-zero word.
+     * @return Bit number, 0 to 31.
+     */
+    static int lowestBit(uint32_t mask)
+    {
+        static const uint8_t deBruijn[32] = {
+            0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+            31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9};
+        return deBruijn[((mask & (0 - mask)) * 0x077CB531U) >> 27];
+    }
+
+    /**
+     * Gets the decoding table of an encoding.
+     * @return 16 entries indexed by (previous state << 2) | current state.
+     */
+    static const Transition *transitions(Encoding encoding);
+
+protected:
+    static const Transition _X2Transitions[16];
+    static const Transition _X4Transitions[16];
+
+    int _prevState;
+    int _currState;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,144 @@
+/**
+ * Timestamped edge log for the Quadrature Encoder Interface.
+ *
+ * A lock-free single-producer/single-consumer ring buffer. The encoder edge
+ * interrupt is the only producer, one thread is the only consumer and drains
+ * the records in batches with pop(). When the buffer is full new records are
+ * dropped and counted, so the interrupt never waits. The indices are
+ * published with mbed's atomic load and store, whose barriers keep the record
+ * accesses on the right side of them.
+ *
+ * @code
+ * QEIEdgeLog<256> edgeLog;
+ * encoder.setEdgeLog(&edgeLog);
+ * ...
+ * QEIEdgeRecord records[32];
+ * unsigned int n = edgeLog.pop(records, 32);
+ * @endcode
+ */
+
+#ifndef _QEI_EDGE_LOG_H_
+#define _QEI_EDGE_LOG_H_
+
+#include "mbed.h"
+
+/**
+ * One decoded edge.
+ */
+typedef struct QEIEdgeRecord
+{
+    uint32_t time;   //Low 32 bits of the edge timebase (us unless the backend sets another), differences stay correct across the wrap
+    uint8_t state;   //2-bit state after the edge, (A << 1) | B
+    int8_t delta;    //Pulse change: -1, 0 or +1
+    uint8_t invalid; //Non-zero if both channels changed
+    uint8_t reserved;
+} QEIEdgeRecord;
+
+/**
+ * Ring buffer of edge records, see QEIEdgeLog for the storage.
+ */
+class QEIEdgeBuffer
+{
+
+public:
+    /**
+     * Append a record. Producer side, called from the edge interrupt.
+     * @return false if the buffer was full and the record was dropped.
+     */
+    bool push(uint32_t time, uint8_t state, int8_t delta, uint8_t invalid)
+    {
+        uint32_t head = _head;
+        if (head - core_util_atomic_load_u32(&_tail) > _mask)
+        {
+            _overflows++;
+            return false;
+        }
+
+        QEIEdgeRecord &record = _buffer[head & _mask];
+        record.time = time;
+        record.state = state;
+        record.delta = delta;
+        record.invalid = invalid;
+
+        //Publish the record after it is written, the consumer only reads up to _head.
+        core_util_atomic_store_u32(&_head, head + 1);
+        return true;
+    }
+
+    /**
+     * Remove up to max of the oldest records. Consumer side, thread context.
+     * @param records Destination for the records.
+     * @param max Size of records.
+     * @return Number of records copied.
+     */
+    unsigned int pop(QEIEdgeRecord *records, unsigned int max)
+    {
+        uint32_t tail = _tail;
+        uint32_t count = core_util_atomic_load_u32(&_head) - tail;
+        if (count > max)
+            count = max;
+
+        for (unsigned int i = 0; i < count; i++)
+            records[i] = _buffer[(tail + i) & _mask];
+
+        //Release the slots only after they were copied.
+        core_util_atomic_store_u32(&_tail, tail + count);
+        return count;
+    }
+
+    /**
+     * @return Number of records waiting to be popped.
+     */
+    unsigned int size() const
+    {
+        return core_util_atomic_load_u32(&_head) - core_util_atomic_load_u32(&_tail);
+    }
+
+    /**
+     * @return Maximum number of records held.
+     */
+    unsigned int capacity() const
+    {
+        return _mask + 1;
+    }
+
+    /**
+     * @return Number of records dropped because the buffer was full.
+     */
+    unsigned int getOverflows() const
+    {
+        return _overflows;
+    }
+
+protected:
+    QEIEdgeBuffer(QEIEdgeRecord *buffer, unsigned int capacity) : _buffer(buffer), _mask(capacity - 1), _head(0), _tail(0), _overflows(0)
+    {
+    }
+
+    QEIEdgeRecord *_buffer;
+    unsigned int _mask;
+
+    volatile uint32_t _head;          //Written by the producer only
+    volatile uint32_t _tail;          //Written by the consumer only
+    volatile unsigned int _overflows; //Written by the producer only
+};
+
+/**
+ * Edge log with a compile-time capacity.
+ * @tparam N Number of records, must be a power of two.
+ */
+template <unsigned int N>
+class QEIEdgeLog : public QEIEdgeBuffer
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "QEIEdgeLog capacity must be a power of two");
+
+public:
+    QEIEdgeLog() : QEIEdgeBuffer(_storage, N)
+    {
+    }
+
+private:
+    QEIEdgeRecord _storage[N];
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "QEIEvents.h"
+
+#define QEI_EVENTS_STALL_CHECKS 4 //Stall checks per timeout
+
+QEIEvents::QEIEvents(EventQueue *queue, EventFlags *flags)
+{
+    _queue = queue;
+    _flags = flags;
+    _nPending = 0;
+    _nDispatchId = 0;
+    _nDropped = 0;
+    _nDirection = 0;
+    _bMoved = false;
+    _bStalled = true;
+    _nStallId = 0;
+    _nIdleChecks = 0;
+}
+
+QEIEvents::~QEIEvents()
+{
+    setStallTimeout(0);
+
+    core_util_critical_section_enter();
+    int dispatchId = _nDispatchId;
+    _nDispatchId = 0;
+    _nPending = 0;
+    core_util_critical_section_exit();
+
+    if (dispatchId != 0)
+        _queue->cancel(dispatchId);
+}
+
+void QEIEvents::setHandler(Callback<void(uint32_t)> handler)
+{
+    _handler = handler;
+}
+
+void QEIEvents::setStallTimeout(int nTimeout)
+{
+    if (_nStallId != 0)
+    {
+        _queue->cancel(_nStallId);
+        _nStallId = 0;
+    }
+
+    if (nTimeout > 0 && _queue != NULL)
+    {
+        int period = nTimeout / QEI_EVENTS_STALL_CHECKS;
+        _nIdleChecks = 0;
+        _nStallId = _queue->call_every((period > 0) ? period : 1, this, &QEIEvents::checkStall);
+    }
+}
+
+int QEIEvents::getDirection()
+{
+    return _nDirection;
+}
+
+unsigned int QEIEvents::getDropped()
+{
+    return _nDropped;
+}
+
+void QEIEvents::post(uint32_t event)
+{
+    if (_flags != NULL)
+        _flags->set(event);
+
+    if (_queue == NULL)
+        return;
+
+    //Only the first pending event queues a dispatch, later ones are coalesced into it.
+    core_util_critical_section_enter();
+    uint32_t pending = _nPending;
+    _nPending = pending | event;
+    core_util_critical_section_exit();
+
+    if (pending == 0)
+    {
+        int id = _queue->call(this, &QEIEvents::dispatch);
+        if (id == 0)
+        {
+            //Queue full: drop the events so a later post tries again.
+            core_util_critical_section_enter();
+            _nPending = 0;
+            _nDropped++;
+            core_util_critical_section_exit();
+        }
+        else
+        {
+            _nDispatchId = id;
+        }
+    }
+}
+
+void QEIEvents::dispatch()
+{
+    core_util_critical_section_enter();
+    uint32_t events = _nPending;
+    _nPending = 0;
+    _nDispatchId = 0;
+    core_util_critical_section_exit();
+
+    if (events != 0 && _handler)
+        _handler(events);
+}
+
+void QEIEvents::checkStall()
+{
+    if (_bMoved)
+    {
+        _bMoved = false;
+        _bStalled = false;
+        _nIdleChecks = 0;
+    }
+    else if (!_bStalled && ++_nIdleChecks >= QEI_EVENTS_STALL_CHECKS)
+    {
+        _bStalled = true;
+        post(STALL_EVENT);
+    }
+}
@@ -0,0 +1,129 @@
+/**
+ * Deferred event delivery for the Quadrature Encoder Interface.
+ *
+ * The encoder interrupts only mark an event as pending. The first pending
+ * event queues one dispatch on an EventQueue, which calls the handler in the
+ * queue's thread with all events pending by then. Events of a type already
+ * pending are coalesced, so a burst of edges costs one queued call and the
+ * interrupt time does not grow with the work done in the handler. The event
+ * bits can also be set on an EventFlags, which coalesces them itself.
+ *
+ *   INDEX_EVENT     - index edge, see QEIBase::setEvents()
+ *   DIRECTION_EVENT - the direction of counting changed
+ *   STALL_EVENT     - no edge for the stall timeout after moving, needs a queue
+ *   THRESHOLD_EVENT - a compare target fired, see QEICompare::setEvents()
+ *
+ * @code
+ * EventQueue queue;
+ * QEIEvents events(&queue);
+ * events.setHandler(callback(onEvents));
+ * events.setStallTimeout(100);
+ * encoder.setEvents(&events);
+ * queue.dispatch_forever();
+ * @endcode
+ */
+
+#ifndef _QEI_EVENTS_H_
+#define _QEI_EVENTS_H_
+
+#include "mbed.h"
+
+/**
+ * Deferred event delivery.
+ */
+class QEIEvents
+{
+
+public:
+    typedef enum Event
+    {
+        INDEX_EVENT = 0x1,
+        DIRECTION_EVENT = 0x2,
+        STALL_EVENT = 0x4,
+        THRESHOLD_EVENT = 0x8
+    } Event;
+
+    /**
+     * Contructor
+     * @param queue EventQueue to dispatch the handler on, NULL for none.
+     * @param flags EventFlags to set the event bits on, NULL for none.
+     */
+    QEIEvents(EventQueue *queue, EventFlags *flags = NULL);
+
+    /**
+     * Destructor
+     * Cancels the stall check and a queued dispatch.
+     */
+    ~QEIEvents();
+
+    /**
+     * Sets the function called on the queue with the pending events.
+     * @param handler Called with the Event bits pending since the last call.
+     */
+    void setHandler(Callback<void(uint32_t)> handler);
+
+    /**
+     * Sets the time without edges after which a moving encoder is stalled.
+     * Checked on the queue every quarter of the timeout.
+     * @param nTimeout Timeout in milliseconds, 0 disables stall detection.
+     */
+    void setStallTimeout(int nTimeout);
+
+    /**
+     * @return Last counting direction, -1, +1, or 0 before the first edge.
+     */
+    int getDirection();
+
+    /**
+     * @return Dispatches which could not be queued because the queue was full.
+     */
+    unsigned int getDropped();
+
+    /**
+     * Mark an event as pending. Interrupt safe.
+     * @param event Event bits to post.
+     */
+    void post(uint32_t event);
+
+    /**
+     * Record a counted edge. Called from the edge interrupt.
+     * @param delta Pulse change, -1 or +1.
+     */
+    void edge(int delta)
+    {
+        _bMoved = true;
+        if (delta != _nDirection)
+        {
+            if (_nDirection != 0)
+                post(DIRECTION_EVENT);
+            _nDirection = delta;
+        }
+    }
+
+protected:
+    /**
+     * Deliver the pending events. Runs on the queue.
+     */
+    void dispatch();
+
+    /**
+     * Post a stall once no edge came for the timeout. Runs on the queue.
+     */
+    void checkStall();
+
+    EventQueue *_queue;
+    EventFlags *_flags;
+    Callback<void(uint32_t)> _handler;
+
+    volatile uint32_t _nPending; //Events posted but not dispatched yet
+    volatile int _nDispatchId;   //Queued dispatch, 0 if none
+    volatile unsigned int _nDropped;
+
+    volatile int _nDirection;
+    volatile bool _bMoved; //An edge came since the last stall check
+    bool _bStalled;        //Stall posted, no edge since
+    int _nStallId;         //Periodic stall check, 0 if none
+    unsigned int _nIdleChecks;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include "QEIObserver.h"
+
+QEIObserver::QEIObserver(QEIBase &encoder, float fBandwidth, float fPeriod) : _encoder(encoder)
+{
+    _fPeriod = fPeriod;
+    setBandwidth(fBandwidth);
+
+    _nPosition = _encoder.read64();
+    _fFraction = 0;
+    _fVelocity = 0;
+
+    _fSpeedFactor = 1.0;
+    _fPositionFactor = 1.0;
+}
+
+void QEIObserver::setBandwidth(float fBandwidth)
+{
+    float w = 2.0f * (float)M_PI * fBandwidth;
+
+    //Critically damped, zeta = 1.
+    _fKp = 2.0f * w;
+    _fKi = w * w;
+}
+
+void QEIObserver::update()
+{
+    float error = (float)(_encoder.read64() - _nPosition) - _fFraction;
+
+    _fFraction += (_fVelocity + _fKp * error) * _fPeriod;
+    _fVelocity += _fKi * error * _fPeriod;
+
+    //Move whole counts out of the fraction.
+    float whole = floorf(_fFraction);
+    _nPosition += (int64_t)whole;
+    _fFraction -= whole;
+}
+
+void QEIObserver::setSpeedFactor(float fSpeedFactor)
+{
+    _fSpeedFactor = fSpeedFactor;
+}
+
+float QEIObserver::getSpeed()
+{
+    return _fVelocity * _fSpeedFactor;
+}
+
+void QEIObserver::setPositionFactor(float fPositionFactor)
+{
+    _fPositionFactor = fPositionFactor;
+}
+
+float QEIObserver::getPosition()
+{
+    return ((float)_nPosition + _fFraction) * _fPositionFactor;
+}
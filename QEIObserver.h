@@ -0,0 +1,100 @@
+/**
+ * Tracking observer for the Quadrature Encoder Interface.
+ *
+ * A second order phase-locked loop that tracks the pulse count of an encoder.
+ * update() is called at a fixed rate and corrects the estimated position and
+ * velocity with the error against the count:
+ *
+ *   error     = count - position
+ *   position += (velocity + Kp * error) * T
+ *   velocity += Ki * error * T
+ *
+ * with Kp = 2 * w and Ki = w * w for w = 2 * pi * bandwidth, which is a
+ * critically damped loop. The velocity has no averaging window and no
+ * timeout decay, and the position is smooth between counts. A higher
+ * bandwidth follows speed changes faster, a lower one filters the count
+ * quantization more.
+ *
+ * The position is kept as a whole count plus a float fraction so it does
+ * not lose resolution on long runs.
+ */
+
+#ifndef _QEI_OBSERVER_H_
+#define _QEI_OBSERVER_H_
+
+#include "QEI.h"
+
+/**
+ * Tracking observer for the Quadrature Encoder Interface.
+ */
+class QEIObserver
+{
+
+public:
+    /**
+     * Contructor
+     * Starts tracking from the current count at zero velocity.
+     * 
+     * @param encoder the encoder to track
+     * @param fBandwidth loop bandwidth in Hz, well below 1 / (2 * pi * fPeriod)
+     * @param fPeriod time between update() calls in seconds
+     */
+    QEIObserver(QEIBase &encoder, float fBandwidth, float fPeriod);
+
+    /**
+     * Sets the loop bandwidth.
+     * @param fBandwidth loop bandwidth in Hz
+     */
+    void setBandwidth(float fBandwidth);
+
+    /**
+     * Reads the count and advances the observer by one period.
+     * Call it at the fixed rate given to the constructor, from the same
+     * context as the getters.
+     */
+    void update();
+
+    /**
+     * Sets the factor for the getter-functions to convert in another unit.
+     * (1.0=Hz, 1/(X*CPR)=rps, 1/(60*X*CPR)=rpm, 360/(X*CPR)=°/s)
+     * Where X is encoding type [e.g. X4 encoding => X=4]
+     * @param fSpeedFactor - factor to scale from Hz to user unit
+     */
+    void setSpeedFactor(float fSpeedFactor);
+
+    /**
+     * Gets the observed speed as float value.
+     * @return speed The value is scales by the factor set by setSpeedFactor()
+     */
+    float getSpeed();
+
+    /**
+     * Sets the factor for the getter-functions to convert in another unit.
+     * (1.0=Count, 1/(X*CPR)=revolution, 360/(X*CPR)=deg, (2*pi)/(X*CPR)=rad)
+     * Where X is encoding type [e.g. X4 encoding => X=4]
+     * @param fPositionFactor - factor to scale from counts to user unit
+     */
+    void setPositionFactor(float fPositionFactor);
+
+    /**
+     * Gets the observed position as float value.
+     * @return position The value is scales by the factor set by setPositionFactor()
+     */
+    float getPosition();
+
+protected:
+    QEIBase &_encoder;
+
+    float _fPeriod;
+    float _fKp;
+    float _fKi;
+
+    int64_t _nPosition;  //Whole counts of the position estimate
+    float _fFraction;    //Fraction of a count, kept within [0, 1)
+    float _fVelocity;    //Counts per second
+
+    float _fSpeedFactor;
+    float _fPositionFactor;
+};
+
+#endif
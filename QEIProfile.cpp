@@ -0,0 +1,76 @@
+#include "QEIProfile.h"
+
+const uint8_t QEI_PATTERN_FORWARD[4] = {0x00, 0x01, 0x03, 0x02};
+const uint8_t QEI_PATTERN_BACKWARD[4] = {0x00, 0x02, 0x03, 0x01};
+const uint8_t QEI_PATTERN_JITTER[4] = {0x00, 0x01, 0x00, 0x01};
+const uint8_t QEI_PATTERN_INVALID[4] = {0x00, 0x03, 0x00, 0x03};
+
+template <QEIDecoder::Encoding E>
+static QEIProfile profileDecoder(const uint8_t *pattern, unsigned int length, unsigned int steps)
+{
+    QEIProfile profile;
+    QEIDecoder decoder(pattern[length - 1]);
+    volatile int pulses = 0;
+
+    qei_profile_reset(profile);
+    QEICycleCounter::enable();
+
+    int prevState = pattern[length - 1];
+    for (unsigned int i = 0; i < steps; i++)
+    {
+        int state = pattern[i % length];
+
+        //X2 only interrupts on channel A, states where only B changed never reach the decoder.
+        bool seen = (E == QEIDecoder::X4_ENCODING) || ((state ^ prevState) & 2);
+        prevState = state;
+        if (!seen)
+            continue;
+
+        uint32_t start = QEICycleCounter::read();
+        pulses += decoder.step<E>(state).delta;
+        qei_profile_add(profile, QEICycleCounter::read() - start);
+    }
+
+    return profile;
+}
+
+QEIProfile qei_profile_decoder(QEIDecoder::Encoding encoding, const uint8_t *pattern, unsigned int length, unsigned int steps)
+{
+    if (encoding == QEIDecoder::X4_ENCODING)
+        return profileDecoder<QEIDecoder::X4_ENCODING>(pattern, length, steps);
+    else
+        return profileDecoder<QEIDecoder::X2_ENCODING>(pattern, length, steps);
+}
+
+
+QEIProfile qei_profile_packed_decoder(const uint8_t *pattern, unsigned int length, unsigned int steps)
+{
+    QEIProfile profile;
+    volatile int pulses[16] = {0};
+    uint32_t prev = pattern[length - 1] * 0x55555555U;
+
+    qei_profile_reset(profile);
+    QEICycleCounter::enable();
+
+    for (unsigned int i = 0; i < steps; i++)
+    {
+        //Same 2-bit state replicated into all 16 pairs.
+        uint32_t curr = pattern[i % length] * 0x55555555U;
+        uint32_t start = QEICycleCounter::read();
+
+        uint32_t forward, backward, invalid;
+        QEIDecoder::stepPacked(prev, curr, forward, backward, invalid);
+        uint32_t moved = forward | backward;
+        while (moved != 0)
+        {
+            int bit = QEIDecoder::lowestBit(moved);
+            moved &= moved - 1;
+            pulses[bit >> 1] += ((forward >> bit) & 1) ? 1 : -1;
+        }
+
+        qei_profile_add(profile, QEICycleCounter::read() - start);
+        prev = curr;
+    }
+
+    return profile;
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+/**
+ * Cycle measurement for the Quadrature Encoder Interface.
+ *
+ * QEICycleCounter reads the DWT cycle counter on cores that have one
+ * (Cortex-M3/M4/M7) and falls back to the microsecond ticker on the others
+ * (Cortex-M0/M0+), see isCycleAccurate(). The host build counts nanoseconds.
+ *
+ * Building with QEI_PROFILE=1 makes QEIBase record the cost of every edge
+ * decode and of the getSpeed() snapshot, readable with getEncodeProfile()
+ * and getSpeedSnapshotProfile().
+ *
+ * qei_profile_decoder() times the decoder alone over a synthetic state
+ * sequence such as QEI_PATTERN_FORWARD, so encodings and table changes can be
+ * compared without an encoder attached. QEIProfiler times the whole edge
+ * interrupt and the public getters of a QEIBase over the same sequences.
+ */
+
+#ifndef _QEI_PROFILE_H_
+#define _QEI_PROFILE_H_
+
+#include "mbed.h"
+#include "QEIDecoder.h"
+
+#ifndef QEI_PROFILE
+#define QEI_PROFILE 0
+#endif
+
+/**
+ * Free running cycle counter.
+ */
+class QEICycleCounter
+{
+
+public:
+    /**
+     * Enable the counter. Safe to call more than once.
+     */
+    static void enable()
+    {
+#if defined(DWT) && defined(CoreDebug)
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    }
+
+    /**
+     * Read the counter.
+     * @return CPU cycles, or microseconds if isCycleAccurate() is false.
+     */
+    static uint32_t read()
+    {
+#if defined(DWT) && defined(CoreDebug)
+        return DWT->CYCCNT;
+#elif defined(HOST_CYCLE_COUNTER)
+        return host_cycle_read();
+#else
+        return us_ticker_read();
+#endif
+    }
+
+    /**
+     * @return true if read() counts CPU cycles.
+     */
+    static bool isCycleAccurate()
+    {
+#if defined(DWT) && defined(CoreDebug)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @return Unit of read(), for reports.
+     */
+    static const char *getUnit()
+    {
+#if defined(DWT) && defined(CoreDebug)
+        return "cycles";
+#elif defined(HOST_CYCLE_COUNTER)
+        return "ns";
+#else
+        return "us";
+#endif
+    }
+};
+
+/**
+ * Accumulated cost of a measured call.
+ */
+typedef struct QEIProfile
+{
+    uint32_t calls;
+    uint32_t total;
+    uint32_t max;
+} QEIProfile;
+
+inline void qei_profile_reset(QEIProfile &profile)
+{
+    profile.calls = 0;
+    profile.total = 0;
+    profile.max = 0;
+}
+
+inline void qei_profile_add(QEIProfile &profile, uint32_t cycles)
+{
+    profile.calls++;
+    profile.total += cycles;
+    if (cycles > profile.max)
+        profile.max = cycles;
+}
+
+//Synthetic state sequences for qei_profile_decoder(), 2-bit states (A << 1) | B.
+extern const uint8_t QEI_PATTERN_FORWARD[4];  //Continuous forward rotation
+extern const uint8_t QEI_PATTERN_BACKWARD[4]; //Continuous backward rotation
+extern const uint8_t QEI_PATTERN_JITTER[4];   //Oscillation around one edge
+extern const uint8_t QEI_PATTERN_INVALID[4];  //Both channels changing, lost edges
+
+/**
+ * Time the decoder over a repeated state sequence.
+ * X2 skips the states where channel A did not change, as its interrupt would.
+ * @param encoding The encoding to decode with.
+ * @param pattern State sequence, repeated until steps states are decoded.
+ * @param length Number of states in pattern.
+ * @param steps Number of states to decode.
+ * @return Cost per decoded state, including the counter read overhead.
+ */
+QEIProfile qei_profile_decoder(QEIDecoder::Encoding encoding, const uint8_t *pattern, unsigned int length, unsigned int steps);
+
+/**
+ * Time QEIDecoder::stepPacked() with the counter updates of 16 encoders.
+ * Compare with 16 times the qei_profile_decoder() cost of the same pattern.
+ * @param pattern State sequence applied to all 16 bit pairs of the port, repeated until steps samples are decoded.
+ * @param length Number of states in pattern.
+ * @param steps Number of port samples to decode.
+ * @return Cost per decoded port sample, including the counter read overhead.
+ */
+QEIProfile qei_profile_packed_decoder(const uint8_t *pattern, unsigned int length, unsigned int steps);
+
+#endif
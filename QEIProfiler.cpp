@@ -0,0 +1,102 @@
+#include "QEIProfiler.h"
+
+const char *const QEI_PROFILE_METHOD_NAMES[QEI_PROFILE_METHODS] = {
+    "encode()",
+    "index()",
+    "read()",
+    "read64()",
+    "write()",
+    "getRevolutions()",
+    "getSpeed()",
+    "getSpeedQ16()",
+    "getAcceleration()",
+    "getPosition()",
+    "getPositionQ16()",
+    "getPositionInterpolated()",
+    "getPositionInterpolatedQ16()",
+    "getDiagnostics()",
+};
+
+//Time one statement into report[method].
+#define QEI_PROFILE_CALL(method, statement)                                \
+    do                                                                     \
+    {                                                                      \
+        uint32_t profileStart = QEICycleCounter::read();                   \
+        statement;                                                         \
+        qei_profile_add(report[method], QEICycleCounter::read() - profileStart); \
+    } while (0)
+
+QEIProfiler::QEIProfiler(Encoding encoding) : QEIBase(NC, NC, NC, encoding)
+{
+}
+
+void QEIProfiler::run(const uint8_t *pattern, unsigned int length, unsigned int steps, QEIProfile report[QEI_PROFILE_METHODS], unsigned int getterInterval)
+{
+    for (int i = 0; i < QEI_PROFILE_METHODS; i++)
+        qei_profile_reset(report[i]);
+    QEICycleCounter::enable();
+
+    //Start from the state before the first one of the pattern.
+    _currState = pattern[length - 1];
+    _prevState = _currState;
+
+    if (_encoding == X4_ENCODING)
+        runPattern<X4_ENCODING>(pattern, length, steps, report, getterInterval);
+    else
+        runPattern<X2_ENCODING>(pattern, length, steps, report, getterInterval);
+}
+
+template <QEIBase::Encoding E>
+void QEIProfiler::runPattern(const uint8_t *pattern, unsigned int length, unsigned int steps, QEIProfile report[QEI_PROFILE_METHODS], unsigned int getterInterval)
+{
+    int prevState = _currState;
+
+    for (unsigned int i = 0; i < steps; i++)
+    {
+        int state = pattern[i % length];
+
+        //X2 only interrupts on channel A.
+        if (E == X4_ENCODING || ((state ^ prevState) & 2))
+            QEI_PROFILE_CALL(QEI_PROFILE_ENCODE, process<E>(state, _SpeedTimer.read_high_resolution_us()));
+        prevState = state;
+
+        if (getterInterval > 0 && (i % getterInterval) == getterInterval - 1)
+            profileGetters(report);
+    }
+}
+
+void QEIProfiler::profileGetters(QEIProfile report[QEI_PROFILE_METHODS])
+{
+    volatile int64_t sink;
+    volatile float sinkFloat;
+    int pulses;
+
+    QEI_PROFILE_CALL(QEI_PROFILE_INDEX, index());
+    QEI_PROFILE_CALL(QEI_PROFILE_READ, pulses = read());
+    QEI_PROFILE_CALL(QEI_PROFILE_READ64, sink = read64());
+    QEI_PROFILE_CALL(QEI_PROFILE_WRITE, write(pulses));
+    QEI_PROFILE_CALL(QEI_PROFILE_GET_REVOLUTIONS, sink = getRevolutions());
+    QEI_PROFILE_CALL(QEI_PROFILE_GET_SPEED, sinkFloat = getSpeed());
+    QEI_PROFILE_CALL(QEI_PROFILE_GET_SPEED_Q16, sink = getSpeedQ16());
+    QEI_PROFILE_CALL(QEI_PROFILE_GET_ACCELERATION, sinkFloat = getAcceleration());
+    QEI_PROFILE_CALL(QEI_PROFILE_GET_POSITION, sinkFloat = getPosition());
+    QEI_PROFILE_CALL(QEI_PROFILE_GET_POSITION_Q16, sink = getPositionQ16());
+    QEI_PROFILE_CALL(QEI_PROFILE_GET_POSITION_INTERPOLATED, sinkFloat = getPositionInterpolated());
+    QEI_PROFILE_CALL(QEI_PROFILE_GET_POSITION_INTERPOLATED_Q16, sink = getPositionInterpolatedQ16());
+    QEI_PROFILE_CALL(QEI_PROFILE_GET_DIAGNOSTICS, sink = getDiagnostics().invalidTransitions);
+
+    (void)sink;
+    (void)sinkFloat;
+}
+
+QEIProfile QEIProfiler::overhead(unsigned int calls)
+{
+    QEIProfile report[1];
+
+    qei_profile_reset(report[0]);
+    QEICycleCounter::enable();
+    for (unsigned int i = 0; i < calls; i++)
+        QEI_PROFILE_CALL(0, );
+
+    return report[0];
+}
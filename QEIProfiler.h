@@ -0,0 +1,96 @@
+/**
+ * Per-method cost of the Quadrature Encoder Interface.
+ *
+ * QEIProfiler is a QEIBase without pins which decodes a synthetic state
+ * sequence through the same path as the edge interrupt and calls every
+ * runtime getter at a fixed edge interval, timing each call with
+ * QEICycleCounter. It runs on the target, in cycles where the core has a
+ * DWT, and on the host build, in nanoseconds.
+ *
+ * The edge interrupt is timed from the edge timer read on: counters, speed
+ * estimator, diagnostics and any attached edge log, compare or events. The
+ * two pin reads in front of it are left out as they cannot be simulated.
+ *
+ * @code
+ * QEIProfiler profiler(QEI::X4_ENCODING);
+ * QEIProfile report[QEI_PROFILE_METHODS];
+ * profiler.run(QEI_PATTERN_FORWARD, 4, 10000, report);
+ * for (int i = 0; i < QEI_PROFILE_METHODS; i++)
+ *     printf("%s %lu\n", QEI_PROFILE_METHOD_NAMES[i], report[i].total / report[i].calls);
+ * @endcode
+ */
+
+#ifndef _QEI_PROFILER_H_
+#define _QEI_PROFILER_H_
+
+#include "QEI.h"
+#include "QEIProfile.h"
+
+/**
+ * Methods timed by QEIProfiler::run().
+ */
+typedef enum QEIProfileMethod
+{
+    QEI_PROFILE_ENCODE, //Edge interrupt after the pin reads
+    QEI_PROFILE_INDEX,  //Index interrupt
+    QEI_PROFILE_READ,
+    QEI_PROFILE_READ64,
+    QEI_PROFILE_WRITE,
+    QEI_PROFILE_GET_REVOLUTIONS,
+    QEI_PROFILE_GET_SPEED,
+    QEI_PROFILE_GET_SPEED_Q16,
+    QEI_PROFILE_GET_ACCELERATION,
+    QEI_PROFILE_GET_POSITION,
+    QEI_PROFILE_GET_POSITION_Q16,
+    QEI_PROFILE_GET_POSITION_INTERPOLATED,
+    QEI_PROFILE_GET_POSITION_INTERPOLATED_Q16,
+    QEI_PROFILE_GET_DIAGNOSTICS,
+    QEI_PROFILE_METHODS
+} QEIProfileMethod;
+
+extern const char *const QEI_PROFILE_METHOD_NAMES[QEI_PROFILE_METHODS];
+
+/**
+ * Times the edge interrupt and the getters of a QEIBase.
+ */
+class QEIProfiler : public QEIBase
+{
+
+public:
+    /**
+     * Contructor
+     * @param encoding The encoding to decode with. X2 skips the states where
+     * channel A did not change, as its interrupt would.
+     */
+    QEIProfiler(Encoding encoding = X4_ENCODING);
+
+    /**
+     * Decode a repeated state sequence and time every call.
+     * The setters, filter, edge log, compare and events configured on the
+     * profiler beforehand are part of the measurement.
+     * 
+     * @param pattern State sequence, 2-bit states (A << 1) | B.
+     * @param length Number of states in pattern.
+     * @param steps Number of states to go through.
+     * @param report Filled with the cost per call of each method, including the counter read overhead.
+     * @param getterInterval States between two rounds of getter calls.
+     */
+    void run(const uint8_t *pattern, unsigned int length, unsigned int steps, QEIProfile report[QEI_PROFILE_METHODS], unsigned int getterInterval = 16);
+
+    /**
+     * Time an empty measurement, to subtract from the reported costs.
+     * @param calls Number of measurements.
+     */
+    static QEIProfile overhead(unsigned int calls);
+
+protected:
+    template <Encoding E>
+    void runPattern(const uint8_t *pattern, unsigned int length, unsigned int steps, QEIProfile report[QEI_PROFILE_METHODS], unsigned int getterInterval);
+
+    /**
+     * Time one call of every getter.
+     */
+    void profileGetters(QEIProfile report[QEI_PROFILE_METHODS]);
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "QEIReplay.h"
+
+//Real time of the replay. The host Timer follows the simulated time, which the replay does not advance.
+class QEIReplayClock
+{
+
+public:
+    QEIReplayClock()
+    {
+#if defined(HOST_CYCLE_COUNTER)
+        _nStart = host_clock_us();
+#else
+        _timer.start();
+#endif
+    }
+
+    us_timestamp_t elapsed()
+    {
+#if defined(HOST_CYCLE_COUNTER)
+        return host_clock_us() - _nStart;
+#else
+        return _timer.read_high_resolution_us();
+#endif
+    }
+
+private:
+#if defined(HOST_CYCLE_COUNTER)
+    us_timestamp_t _nStart;
+#else
+    Timer _timer;
+#endif
+};
+
+QEIReplay::QEIReplay(Encoding encoding) : QEIBase(NC, NC, NC, encoding)
+{
+    _nTraceTime = 0;
+}
+
+us_timestamp_t QEIReplay::now()
+{
+    return _nTraceTime;
+}
+
+bool QEIReplay::run(const uint8_t *trace, size_t size, us_timestamp_t speedPeriod, QEIReplayResult &result, Callback<void(us_timestamp_t, float)> onSpeed)
+{
+    QEITraceReader reader(trace, size);
+    QEITraceEvent event;
+
+    reset();
+    resetDiagnostics();
+    _speed = QEISpeedEstimator();
+    _nTraceTime = 0;
+
+    result.edges = 0;
+    result.indexPulses = 0;
+    result.duration = 0;
+
+    //Initial state, nothing to decode yet.
+    if (reader.next(event))
+    {
+        _currState = event.state;
+        _prevState = event.state;
+        _nTraceTime = event.time;
+    }
+    us_timestamp_t nextSample = _nTraceTime + speedPeriod;
+    int traceState = _currState;
+
+    QEIReplayClock clock;
+
+    while (reader.next(event))
+    {
+        //Speed samples due before this record see the time they are due at.
+        while (speedPeriod > 0 && nextSample <= event.time)
+        {
+            _nTraceTime = nextSample;
+            float speed = getSpeed();
+            if (onSpeed)
+                onSpeed(nextSample, speed);
+            nextSample += speedPeriod;
+        }
+
+        _nTraceTime = event.time;
+
+        if (event.index)
+        {
+            index();
+            result.indexPulses++;
+        }
+        else
+        {
+            //X2 only interrupts on channel A, B-only changes are never seen.
+            if (_encoding == X4_ENCODING || ((event.state ^ traceState) & 2))
+            {
+                process(event.state, event.time);
+                result.edges++;
+            }
+            traceState = event.state;
+        }
+    }
+
+    us_timestamp_t elapsed = clock.elapsed();
+
+    result.pulses = read64();
+    result.revolutions = getRevolutions();
+    result.duration = _nTraceTime;
+    result.elapsed = elapsed;
+    result.edgeRate = result.elapsed > 0 ? 1000000.0f * (float)(result.edges + result.indexPulses) / (float)result.elapsed : 0;
+    result.error = !reader.isValid() || reader.hasError();
+
+    return !result.error;
+}
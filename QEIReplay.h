@@ -0,0 +1,78 @@
+/**
+ * Replays a recorded edge trace through the QEI decoder.
+ *
+ * QEIReplay is a QEIBase without pins. run() feeds every record of a
+ * QEITrace through the same decode and index paths as the edge interrupts,
+ * with the trace times as timebase, as fast as the target can decode. Speed
+ * is sampled at a fixed period of trace time, the final counts and the
+ * decode throughput are returned in a QEIReplayResult.
+ *
+ * As with QEI, X2 decoding only sees the records where channel A changed.
+ * The glitch filter re-reads the pins, use setGlitchFilter(1, width) here.
+ *
+ * @code
+ * QEIReplay replay(QEI::X4_ENCODING);
+ * QEIReplayResult result;
+ * replay.run(trace, sizeof(trace), 10000, result, callback(printSpeed));
+ * printf("%lld pulses, %f edges/s\n", result.pulses, result.edgeRate);
+ * @endcode
+ */
+
+#ifndef _QEI_REPLAY_H_
+#define _QEI_REPLAY_H_
+
+#include "QEI.h"
+#include "QEITrace.h"
+
+/**
+ * Outcome of a replay.
+ */
+typedef struct QEIReplayResult
+{
+    unsigned int edges;       //Edge records decoded
+    unsigned int indexPulses; //Index records replayed
+    int64_t pulses;           //read64() after the trace
+    int revolutions;          //getRevolutions() after the trace
+    us_timestamp_t duration;  //Trace time of the last record
+    us_timestamp_t elapsed;   //Real time the replay took, including the speed samples, on the host too
+    float edgeRate;           //Edge and index records replayed per second of real time
+    bool error;               //Invalid header or malformed record, the result covers the records before it
+} QEIReplayResult;
+
+/**
+ * QEI decoder driven by a recorded trace.
+ */
+class QEIReplay : public QEIBase
+{
+
+public:
+    /**
+     * Contructor
+     * @param encoding The encoding to replay with.
+     */
+    QEIReplay(Encoding encoding = X4_ENCODING);
+
+    /**
+     * Replay a trace.
+     * Resets the counts, the speed estimate and the diagnostics first. The
+     * first record sets the initial state, like the pins at construction of QEI.
+     * 
+     * @param trace Trace including the header.
+     * @param size Size of trace in bytes.
+     * @param speedPeriod Trace time between speed samples in microseconds, 0 for none.
+     * @param result Filled with the outcome.
+     * @param onSpeed Called with the trace time and getSpeed() at every speed sample.
+     * @return false on an invalid header or malformed record.
+     */
+    bool run(const uint8_t *trace, size_t size, us_timestamp_t speedPeriod, QEIReplayResult &result, Callback<void(us_timestamp_t, float)> onSpeed = NULL);
+
+protected:
+    /**
+     * @return The trace time of the record being replayed.
+     */
+    virtual us_timestamp_t now();
+
+    us_timestamp_t _nTraceTime;
+};
+
+#endif
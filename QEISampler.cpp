@@ -0,0 +1,166 @@
+#include "QEISampler.h"
+
+QEISampler::QEISampler(PinName channelA, PinName channelB, us_timestamp_t nPeriod, Encoding encoding, unsigned int nFilterSamples) : _channelA(channelA, PullUp), _channelB(channelB, PullUp)
+{
+    _encoding = encoding;
+    _nPeriod = nPeriod;
+    _nFilterSamples = (nFilterSamples > 0) ? nFilterSamples : 1;
+
+    _head = 0;
+    _tail = 0;
+    _overflows = 0;
+    _nTick = 0;
+
+    _nCandidateCount = 0;
+    _nRejected = 0;
+    _nSampleTime = 0;
+    _nLastTick = 0;
+    _nValidOverflows = _overflows;
+
+    _pulses = 0;
+    _fSpeedFactor = 1.0;
+    _fPositionFactor = 1.0;
+
+    //Workout what the current state is.
+    int chanA = _channelA.read();
+    int chanB = _channelB.read();
+
+    //2-bit state
+    _currState = (chanA << 1) | chanB;
+    _prevState = _currState;
+    _nCandidate = _currState;
+
+    _ticker.attach_us(callback(this, &QEISampler::sample), _nPeriod);
+}
+
+QEISampler::~QEISampler()
+{
+    _ticker.detach();
+}
+
+void QEISampler::sample()
+{
+    //Dropped samples still count, so process() can tell how long a gap was.
+    uint16_t tick = _nTick + 1;
+    _nTick = tick;
+
+    uint32_t head = _head;
+    if (head - core_util_atomic_load_u32(&_tail) >= QEI_SAMPLER_BUFFER)
+    {
+        _overflows++;
+        return;
+    }
+
+    _samples[head & (QEI_SAMPLER_BUFFER - 1)] = (uint16_t)((tick << 2) | (_channelA.read() << 1) | _channelB.read());
+    core_util_atomic_store_u32(&_head, head + 1);
+}
+
+unsigned int QEISampler::process()
+{
+    uint32_t tail = _tail;
+    uint32_t count = core_util_atomic_load_u32(&_head) - tail;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        uint16_t sample = _samples[(tail + i) & (QEI_SAMPLER_BUFFER - 1)];
+        int state = sample & 0x03;
+
+        //Samples since the previous one, more than 1 after an overflow.
+        unsigned int gap = (uint16_t)((sample >> 2) - _nLastTick) & 0x3FFF;
+        _nLastTick = (sample >> 2) & 0x3FFF;
+        if (gap == 0)
+            gap = 0x4000;
+        _nSampleTime += gap * _nPeriod;
+
+        //The filter samples are no longer consecutive after a gap.
+        if (gap > 1)
+            _nCandidateCount = 0;
+
+        //Glitch filter: a state must be seen in _nFilterSamples consecutive samples.
+        if (state != _nCandidate)
+        {
+            if (_nCandidate != _currState && _nCandidateCount < _nFilterSamples)
+                _nRejected++;
+            _nCandidate = state;
+            _nCandidateCount = 1;
+        }
+        else if (_nCandidateCount < _nFilterSamples)
+        {
+            _nCandidateCount++;
+        }
+
+        if (_nCandidateCount < _nFilterSamples || state == _currState)
+            continue;
+
+        //X2 encoding only looks at the states where channel A changed.
+        if (_encoding == X2_ENCODING && ((state ^ _currState) & 0x02) == 0)
+            continue;
+
+        const Transition transition = step(_encoding, state);
+        if (transition.delta != 0)
+        {
+            _pulses += transition.delta;
+            _speed.edge(transition.delta, _nSampleTime);
+        }
+    }
+
+    core_util_atomic_store_u32(&_tail, tail + count);
+    return count;
+}
+
+void QEISampler::reset()
+{
+    process();
+    _pulses = 0;
+    _nValidOverflows = _overflows;
+}
+
+int QEISampler::read()
+{
+    process();
+    return _pulses;
+}
+
+void QEISampler::write(int pulses)
+{
+    process();
+    _pulses = pulses;
+    _nValidOverflows = _overflows;
+}
+
+void QEISampler::setSpeedFactor(float fSpeedFactor)
+{
+    _fSpeedFactor = fSpeedFactor;
+}
+
+float QEISampler::getSpeed()
+{
+    process();
+    _speed.sample(_nSampleTime);
+    return _speed.getSpeed(_fSpeedFactor);
+}
+
+void QEISampler::setPositionFactor(float fPositionFactor)
+{
+    _fPositionFactor = fPositionFactor;
+}
+
+float QEISampler::getPosition()
+{
+    return (float)read() * _fPositionFactor;
+}
+
+unsigned int QEISampler::getRejected()
+{
+    return _nRejected;
+}
+
+unsigned int QEISampler::getOverflows()
+{
+    return _overflows;
+}
+
+bool QEISampler::isPositionValid()
+{
+    return _overflows == _nValidOverflows;
+}
@@ -0,0 +1,163 @@
+/**
+ * Quadrature Encoder Interface sampled at a fixed rate.
+ *
+ * A Ticker interrupt samples channels A and B every period and stores the
+ * 2-bit state in a ring buffer, nothing else. process() decodes the buffered
+ * samples in thread context. The interrupt load is fixed by the sample rate,
+ * so chatter on a noisy encoder cannot cause an interrupt storm, and a state
+ * only counts once it was seen in nFilterSamples consecutive samples.
+ *
+ * The sample rate must be above the highest edge rate times nFilterSamples,
+ * otherwise edges are missed and show up as invalid transitions.
+ *
+ * mbed has no portable GPIO DMA, so the sampling is done by the Ticker
+ * interrupt. The decoding does not depend on how the buffer was filled.
+ *
+ * Each sample carries its sample number, so when the buffer overflows the
+ * dropped samples still advance the time (gaps are measured modulo 2^14
+ * samples, so keep process() calls closer than that). The pulses the encoder made while
+ * samples were dropped may be lost though, so isPositionValid() turns false
+ * until the position is set again with write() or reset().
+ */
+
+#ifndef _QEI_SAMPLER_H_
+#define _QEI_SAMPLER_H_
+
+#include "mbed.h"
+#include "QEIDecoder.h"
+#include "QEISpeed.h"
+
+#define QEI_SAMPLER_BUFFER 256 //Samples buffered between process() calls, power of two
+
+/**
+ * Quadrature Encoder Interface sampled at a fixed rate.
+ */
+class QEISampler : public QEIDecoder
+{
+
+public:
+    /**
+     * Contructor
+     * Read the current values on channel A and B to determine the initial state
+     * and start sampling.
+     * 
+     * @param channelA mbed pin for channel A input
+     * @param channelB mbed pin for channel B input
+     * @param nPeriod sample period in microseconds
+     * @param encoding The encoding to use. X2 only decodes samples where channel A changed.
+     * @param nFilterSamples consecutive equal samples needed to accept a state, 1 disables filtering.
+     */
+    QEISampler(PinName channelA, PinName channelB, us_timestamp_t nPeriod, Encoding encoding = X4_ENCODING, unsigned int nFilterSamples = 1);
+
+    /**
+     * Destructor
+     * Stops sampling.
+     */
+    ~QEISampler();
+
+    /**
+     * Decode the buffered samples. Thread context.
+     * The getters below call it, call it directly to keep the buffer from
+     * overflowing when they are not called often enough.
+     * @return Number of samples decoded.
+     */
+    unsigned int process();
+
+    /**
+     * Reset the encoder.
+     * 
+     * Sets the pulses count to zero.
+     */
+    void reset();
+
+    /**
+     * Read the number of pulses recorded by the encoder.
+     * @return Number of pulses which have occured.
+     */
+    int read();
+
+    /**
+     * Sets the number of pulses
+     * @param pulses Number of pulses which to set.
+     */
+    void write(int pulses);
+
+    /**
+     * Sets the factor for the getter-functions to convert in another unit.
+     * (1.0=Hz, 1/(X*CPR)=rps, 1/(60*X*CPR)=rpm, 360/(X*CPR)=°/s)
+     * Where X is encoding type [e.g. X4 encoding => X=4]
+     * @param fSpeedFactor - factor to scale from Hz to user unit
+     */
+    void setSpeedFactor(float fSpeedFactor);
+
+    /**
+     * Gets the speed as float value, see QEISpeedEstimator.
+     * Edge times are the sample times, so the resolution is one period.
+     * @return speed The value is scales by the factor set by setSpeedFactor()
+     */
+    float getSpeed();
+
+    /**
+     * Sets the factor for the getter-functions to convert in another unit.
+     * (1.0=Count, 1/(X*CPR)=revolution, 360/(X*CPR)=deg, (2*pi)/(X*CPR)=rad)
+     * Where X is encoding type [e.g. X4 encoding => X=4]
+     * @param fPositionFactor - factor to scale from counts to user unit
+     */
+    void setPositionFactor(float fPositionFactor);
+
+    /**
+     * Gets the position as float value.
+     * @return position The value is scales by the factor set by setPositionFactor()
+     */
+    float getPosition();
+
+    /**
+     * @return Number of state changes rejected by the filter.
+     */
+    unsigned int getRejected();
+
+    /**
+     * @return Number of samples dropped because the buffer was full.
+     */
+    unsigned int getOverflows();
+
+    /**
+     * @return false once samples were dropped since the last write() or
+     * reset(), the count may have missed pulses since.
+     */
+    bool isPositionValid();
+
+protected:
+    /**
+     * Called by the Ticker every period, stores one sample.
+     */
+    void sample();
+
+    DigitalIn _channelA;
+    DigitalIn _channelB;
+    Ticker _ticker;
+
+    Encoding _encoding;
+    us_timestamp_t _nPeriod;
+    unsigned int _nFilterSamples;
+
+    uint16_t _samples[QEI_SAMPLER_BUFFER]; //State in bits 0-1, sample number modulo 2^14 above
+    uint16_t _nTick;                       //Sample number, written by sample() only
+    volatile uint32_t _head;          //Written by sample() only, atomic store after the sample
+    volatile uint32_t _tail;          //Written by process() only, atomic store after the decoding
+    volatile unsigned int _overflows; //Written by sample() only
+
+    int _nCandidate;              //State waiting to pass the filter
+    unsigned int _nCandidateCount;
+    unsigned int _nRejected;
+    us_timestamp_t _nSampleTime;  //Time of the last decoded sample
+    uint16_t _nLastTick;          //Sample number of the last decoded sample
+    unsigned int _nValidOverflows; //_overflows at the last write() or reset()
+
+    int _pulses;
+    float _fSpeedFactor;
+    float _fPositionFactor;
+    QEISpeedEstimator _speed;
+};
+
+#endif
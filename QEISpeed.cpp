@@ -0,0 +1,125 @@
+#include "QEISpeed.h"
+
+int64_t qei_ratio_q48(int32_t nNumerator, int32_t nDenominator)
+{
+    //Long division in two steps, so nothing exceeds 64 bits.
+    uint64_t numerator = (nNumerator < 0) ? (uint64_t)(-(int64_t)nNumerator) : (uint64_t)nNumerator;
+    uint64_t denominator = (nDenominator < 0) ? (uint64_t)(-(int64_t)nDenominator) : (uint64_t)nDenominator;
+
+    uint64_t high = (numerator << 16) / denominator;
+    uint64_t remainder = (numerator << 16) % denominator;
+    uint64_t low = (remainder << 32) / denominator;
+    remainder = (remainder << 32) % denominator;
+
+    int64_t ratio = (int64_t)((high << 32) + low + ((remainder * 2 >= denominator) ? 1 : 0));
+    return ((nNumerator < 0) != (nDenominator < 0)) ? -ratio : ratio;
+}
+
+QEISpeedEstimator::QEISpeedEstimator()
+{
+    _nFrequency = 1000000;
+    _nLastTimer = 0;
+    _nPulses = 0;
+    _nEdgeCount = 0;
+    _bReferenced = false;
+    _nRefPulses = 0;
+    _nRefTimer = 0;
+    _nRefCount = 0;
+    _nSampleTime = 0;
+    _nCounts = 0;
+    _nTime = 1;
+    _nRateQ16 = 0;
+    _nTag = 0;
+    _nPrevCounts = 0;
+    _nPrevTime = 1;
+    _nPrevTag = 0;
+    _nEstimates = 0;
+}
+
+void QEISpeedEstimator::sample(uint64_t now)
+{
+    unsigned int edgeCount;
+    uint32_t pulses;
+    uint64_t edgeTimer;
+
+    //edge() increments the edge count on every update, so an unchanged
+    //count means the totals were read without an edge in between.
+    do
+    {
+        edgeCount = _nEdgeCount;
+        pulses = _nPulses;
+        edgeTimer = _nLastTimer;
+    } while (edgeCount != _nEdgeCount);
+
+    if (edgeCount != _nRefCount)
+    {
+        //M/T: pulses over the exact time between the last edges of two samples.
+        if (_bReferenced)
+        {
+            //The totals wrap, their modular difference is right for up to 2^31 pulses.
+            int32_t counts = (int32_t)(pulses - _nRefPulses);
+            uint32_t magnitude = (counts < 0) ? (uint32_t)0 - (uint32_t)counts : (uint32_t)counts;
+            uint64_t time = edgeTimer - _nRefTimer;
+            uint64_t tag = _nRefTimer + time / 2;
+
+            //After a reversal the time between the last edges is not a pulse
+            //period: a dither across a sample would be one pulse over a few
+            //microseconds. Take at least the time since the previous sample,
+            //also when the previous direction is unknown.
+            bool reversed = magnitude != edgeCount - _nRefCount || _nCounts == 0 || (counts > 0) != (_nCounts > 0);
+            if (reversed && now - _nSampleTime > time)
+            {
+                time = now - _nSampleTime;
+                tag = _nSampleTime + time / 2;
+            }
+            setEstimate(counts, (time > 0) ? time : 1, tag);
+        }
+        _bReferenced = true;
+        _nRefPulses = pulses;
+        _nRefTimer = edgeTimer;
+        _nRefCount = edgeCount;
+    }
+    else if (_nCounts != 0)
+    {
+        //1/T: without a new edge the speed is at most one pulse over the time since the last one.
+        uint64_t since = now - _nRefTimer;
+        unsigned int counts = (_nCounts > 0) ? _nCounts : -_nCounts;
+        if (since > _nTime / counts)
+            setEstimate((_nCounts > 0) ? 1 : -1, since, _nRefTimer + since / 2);
+    }
+
+    _nSampleTime = now;
+}
+
+void QEISpeedEstimator::setEstimate(int counts, uint64_t time, uint64_t tag)
+{
+    _nPrevCounts = _nCounts;
+    _nPrevTime = _nTime;
+    _nPrevTag = _nTag;
+
+    _nCounts = counts;
+    _nTime = time;
+    _nTag = tag;
+
+    //Pulses per second in Q16.16, rounded. The remainder keeps
+    //counts * frequency * 65536 from overflowing at MHz ticks.
+    int64_t scaled = (int64_t)counts * _nFrequency;
+    int64_t whole = scaled / (int64_t)time;
+    int64_t remainder = (scaled - whole * (int64_t)time) * 65536;
+    int64_t half = (int64_t)(time / 2);
+    _nRateQ16 = whole * 65536 + (remainder + ((remainder >= 0) ? half : -half)) / (int64_t)time;
+
+    if (_nEstimates < 2)
+        _nEstimates++;
+}
+
+float QEISpeedEstimator::getAcceleration(float fFactor) const
+{
+    if (_nEstimates < 2 || _nTag <= _nPrevTag)
+        return 0;
+
+    float frequency = (float)_nFrequency;
+    float speed = frequency * (float)_nCounts / (float)_nTime;
+    float prevSpeed = frequency * (float)_nPrevCounts / (float)_nPrevTime;
+    return frequency * fFactor * (speed - prevSpeed) / (float)(_nTag - _nPrevTag);
+}
\ No newline at end of file
@@ -0,0 +1,212 @@
+/**
+ * M/T speed estimator for quadrature encoders.
+ *
+ * The edge interrupt calls edge() for every counted pulse, which only
+ * records the edge time and bumps two running counters. sample() runs in
+ * thread context at a fixed rate and divides the pulses since its previous
+ * call by the exact time between the last edges before the two calls. At
+ * high speed this is a count over the sample interval, at low speed it
+ * becomes the period of the last edge. After a change of direction, since
+ * the previous estimate or between the edges of this one, the edge times are
+ * no pulse period, so the time is at least the one since the previous
+ * sample. The same holds while the previous direction is unknown, for the
+ * first estimate and after one of 0 pulses. If no edge happened since the previous sample, the speed is
+ * limited to one pulse over the time since the last edge and decays towards
+ * zero as the encoder stops.
+ *
+ * The estimate is kept as an integer pair, getCounts() pulses per getTime()
+ * microseconds, so float and fixed-point results come from the same sample.
+ * getAcceleration() differentiates the last two estimates, each placed at the
+ * middle of the interval it was measured over.
+ *
+ * sample() copies the running totals without disabling interrupts and
+ * retries if an edge lands in the few instructions between its reads. A
+ * second retry needs another edge in that window, so in practice there is at
+ * most one retry. An unbounded number only happens if edges come faster than
+ * the interrupt can run, and then counts are being lost anyway. sample()
+ * must not preempt edge(), call it from thread context or from an interrupt
+ * with lower priority than the encoder edges.
+ *
+ * Only depends on <stdint.h>. Times are microseconds unless setFrequency()
+ * selects another timebase, e.g. the tick rate of a hardware capture timer.
+ */
+
+#ifndef _QEI_SPEED_H_
+#define _QEI_SPEED_H_
+
+#include <stdint.h>
+
+/**
+ * Converts an integer ratio to a Q16.48 multiplier for qei_scale_q48().
+ * Divides, so call it when the ratio is set, not per reading.
+ * @param nNumerator - numerator of the ratio
+ * @param nDenominator - denominator of the ratio, must not be 0
+ * @return nNumerator * 2^48 / nDenominator rounded to nearest, the ratio must be below 2^15
+ */
+int64_t qei_ratio_q48(int32_t nNumerator, int32_t nDenominator);
+
+/**
+ * Scales a Q16.16 value by a Q16.48 ratio, rounded to nearest.
+ * Four 32x32-bit multiplies into a 128-bit product, no division. The rounded
+ * ratio is off by at most 2^-49, which moves the result by less than 1/4 LSB
+ * for |value| < 2^47, so it is within one LSB of the exact product. Results
+ * beyond Q16.16, +-32768 in user units, saturate at INT32_MAX and INT32_MIN.
+ */
+inline int32_t qei_scale_q48(int64_t value, int64_t scale)
+{
+    //Magnitudes in unsigned arithmetic, so nothing overflows.
+    bool negative = (value < 0) != (scale < 0);
+    uint64_t a = (value < 0) ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+    uint64_t b = (scale < 0) ? (uint64_t)0 - (uint64_t)scale : (uint64_t)scale;
+
+    uint64_t lowLow = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    uint64_t lowHigh = (a & 0xFFFFFFFF) * (b >> 32);
+    uint64_t highLow = (a >> 32) * (b & 0xFFFFFFFF);
+    uint64_t highHigh = (a >> 32) * (b >> 32);
+
+    //128-bit product in two halves, plus half an LSB of the result at bit 47.
+    uint64_t middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFF) + (highLow & 0xFFFFFFFF);
+    uint64_t low = (middle << 32) | (lowLow & 0xFFFFFFFF);
+    uint64_t high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+    uint64_t rounded = low + ((uint64_t)1 << 47);
+    if (rounded < low)
+        high++;
+
+    //Q16.16 is the product over 2^48, anything from bit 80 up is out of range.
+    uint64_t magnitude = (high << 16) | (rounded >> 48);
+    if (high >> 16)
+        magnitude = (uint64_t)1 << 32;
+
+    if (negative)
+        return (magnitude >= 0x80000000) ? INT32_MIN : -(int32_t)magnitude;
+    return (magnitude > 0x7FFFFFFF) ? INT32_MAX : (int32_t)magnitude;
+}
+
+/**
+ * M/T speed estimator.
+ */
+class QEISpeedEstimator
+{
+
+public:
+    QEISpeedEstimator();
+
+    /**
+     * Sets the timebase of the times given to edge() and sample().
+     * @param nFrequency Ticks per second, 1000000 for microseconds.
+     */
+    void setFrequency(uint32_t nFrequency)
+    {
+        _nFrequency = nFrequency;
+    }
+
+    /**
+     * Record a counted edge. Producer side, called from the edge interrupt.
+     * @param delta Pulse change, -1 or +1.
+     * @param time Edge time in timebase ticks.
+     */
+    void edge(int delta, uint64_t time)
+    {
+        _nLastTimer = time;
+        _nPulses += (uint32_t)delta;
+        _nEdgeCount++;
+    }
+
+    /**
+     * @return Time of the last edge passed to edge(). Producer side only.
+     */
+    uint64_t getLastEdgeTime() const
+    {
+        return _nLastTimer;
+    }
+
+    /**
+     * @return Running edge count, changes on every edge() call.
+     */
+    unsigned int getEdgeCount() const
+    {
+        return _nEdgeCount;
+    }
+
+    /**
+     * Update the estimate from the edges since the previous call.
+     * @param now Current time, same timebase as edge().
+     */
+    void sample(uint64_t now);
+
+    /**
+     * @return Pulses of the estimate, per getTime() ticks.
+     */
+    int getCounts() const
+    {
+        return _nCounts;
+    }
+
+    /**
+     * @return Ticks of the estimate, never 0.
+     */
+    uint64_t getTime() const
+    {
+        return _nTime;
+    }
+
+    /**
+     * Gets the estimate as float value.
+     * @param fFactor - factor to scale from Hz to user unit
+     */
+    float getSpeed(float fFactor) const
+    {
+        if (_nCounts == 0)
+            return 0;
+        return (float)_nFrequency * fFactor * (float)_nCounts / (float)_nTime;
+    }
+
+    /**
+     * Gets the estimate as Q16.16 fixed-point value.
+     * The estimate is converted to Q16.16 Hz once by sample(), so this is a
+     * multiply and a shift, within one LSB of the exact value for ratios up to 1.
+     * @param nScale - factor from Hz to user unit, see qei_ratio_q48()
+     */
+    int32_t getSpeedQ16(int64_t nScale) const
+    {
+        return qei_scale_q48(_nRateQ16, nScale);
+    }
+
+    /**
+     * Gets the acceleration between the last two estimates as float value.
+     * @param fFactor - factor to scale from Hz to user unit, as for getSpeed()
+     * @return acceleration in user unit per second, 0 until two estimates exist
+     */
+    float getAcceleration(float fFactor) const;
+
+protected:
+    /**
+     * Replace the estimate, keeping the previous one for getAcceleration().
+     * @param counts Pulses of the new estimate.
+     * @param time Ticks of the new estimate.
+     * @param tag Middle of the interval the estimate was measured over.
+     */
+    void setEstimate(int counts, uint64_t time, uint64_t tag);
+
+    uint32_t _nFrequency;              //Timebase ticks per second
+
+    volatile uint64_t _nLastTimer;     //Time of the last edge, written by edge() only
+    volatile uint32_t _nPulses;        //Running signed edge count modulo 2^32, written by edge() only
+    volatile unsigned int _nEdgeCount; //Running edge count, changes on every edge() call
+
+    bool _bReferenced;         //sample() has seen an edge to measure from
+    uint32_t _nRefPulses;      //Totals at the last edge seen by sample()
+    uint64_t _nRefTimer;
+    unsigned int _nRefCount;
+    uint64_t _nSampleTime;     //now of the previous sample()
+    int _nCounts;              //Estimate, _nCounts pulses per _nTime us
+    uint64_t _nTime;
+    int64_t _nRateQ16;         //Estimate in Q16.16 pulses per second, rounded
+    uint64_t _nTag;            //Middle of the interval of the estimate
+    int _nPrevCounts;          //Previous estimate, for getAcceleration()
+    uint64_t _nPrevTime;
+    uint64_t _nPrevTag;
+    unsigned int _nEstimates;  //Estimates made, saturates at 2
+};
+
+#endif
@@ -0,0 +1,231 @@
+#include "QEITimer.h"
+
+#if defined(TARGET_STM)
+
+#include "pinmap.h"
+#include "PeripheralPins.h"
+
+QEITimer *QEITimer::_instances[QEI_TIMER_TIMERS];
+
+template <int N>
+void QEITimer::handler()
+{
+    _instances[N]->irq();
+}
+
+//Slot, compare interrupt and clock of the timers which support encoder mode
+//on most STM32 families.
+static int enableTimer(TIM_TypeDef *tim, IRQn_Type &irq)
+{
+#if defined(TIM1)
+    if (tim == TIM1)
+    {
+        __HAL_RCC_TIM1_CLK_ENABLE();
+        irq = TIM1_CC_IRQn;
+        return 0;
+    }
+#endif
+#if defined(TIM2)
+    if (tim == TIM2)
+    {
+        __HAL_RCC_TIM2_CLK_ENABLE();
+        irq = TIM2_IRQn;
+        return 1;
+    }
+#endif
+#if defined(TIM3)
+    if (tim == TIM3)
+    {
+        __HAL_RCC_TIM3_CLK_ENABLE();
+        irq = TIM3_IRQn;
+        return 2;
+    }
+#endif
+#if defined(TIM4)
+    if (tim == TIM4)
+    {
+        __HAL_RCC_TIM4_CLK_ENABLE();
+        irq = TIM4_IRQn;
+        return 3;
+    }
+#endif
+#if defined(TIM5)
+    if (tim == TIM5)
+    {
+        __HAL_RCC_TIM5_CLK_ENABLE();
+        irq = TIM5_IRQn;
+        return 4;
+    }
+#endif
+#if defined(TIM8)
+    if (tim == TIM8)
+    {
+        __HAL_RCC_TIM8_CLK_ENABLE();
+        irq = TIM8_CC_IRQn;
+        return 5;
+    }
+#endif
+    return -1;
+}
+
+QEITimer::QEITimer(PinName channelA, PinName channelB, QEIDecoder::Encoding encoding, int nFilter)
+{
+    _nPulses = 0;
+    _nLastCount = 0;
+    _fSpeedFactor = 1.0;
+    _fPositionFactor = 1.0;
+    _nSpeedLastTimer = 0;
+    _nSpeedLastPulses = 0;
+    _fSpeed = 0;
+
+    //Both pins must belong to the same timer, on channels 1 and 2.
+    uint32_t timA = pinmap_peripheral(channelA, PinMap_PWM);
+    uint32_t functionA = pinmap_function(channelA, PinMap_PWM);
+    uint32_t functionB = pinmap_function(channelB, PinMap_PWM);
+    MBED_ASSERT(pinmap_peripheral(channelB, PinMap_PWM) == timA);
+    MBED_ASSERT(STM_PIN_CHANNEL(functionA) == 1 && STM_PIN_CHANNEL(functionB) == 2);
+
+    _tim = (TIM_TypeDef *)(uintptr_t)timA;
+    _nSlot = enableTimer(_tim, _irq);
+    MBED_ASSERT(_nSlot >= 0 && _instances[_nSlot] == NULL);
+
+    pin_function(channelA, functionA);
+    pin_function(channelB, functionB);
+    pin_mode(channelA, PullUp);
+    pin_mode(channelB, PullUp);
+
+    uint32_t filter = (uint32_t)nFilter & 0x0F;
+
+    _tim->CR1 = 0;
+    _tim->SMCR = 0;
+    _tim->DIER = 0;
+    _tim->PSC = 0;
+    _tim->ARR = 0xFFFF;
+
+    //TI1 and TI2 mapped on themselves, with the input filter.
+    _tim->CCMR1 = TIM_CCMR1_CC1S_0 | TIM_CCMR1_CC2S_0 | (filter << TIM_CCMR1_IC1F_Pos) | (filter << TIM_CCMR1_IC2F_Pos);
+
+    //The timer counts up when channel A leads, QEI counts forward when channel B
+    //leads. Inverting TI1 makes both agree.
+    _tim->CCER = TIM_CCER_CC1P;
+
+    //Channel 3 and 4 frozen output compare, without output, only set their flags.
+    _tim->CCMR2 = 0;
+
+    //SMS=011 counts on both edges of both inputs, SMS=001 on both edges of TI1 only.
+    if (encoding == QEIDecoder::X4_ENCODING)
+        _tim->SMCR = TIM_SMCR_SMS_0 | TIM_SMCR_SMS_1;
+    else
+        _tim->SMCR = TIM_SMCR_SMS_0;
+
+    _tim->EGR = TIM_EGR_UG;
+    _tim->CNT = 0;
+    update();
+    _tim->SR = 0;
+
+    static const uintptr_t handlers[QEI_TIMER_TIMERS] = {(uintptr_t)&handler<0>, (uintptr_t)&handler<1>, (uintptr_t)&handler<2>, (uintptr_t)&handler<3>, (uintptr_t)&handler<4>, (uintptr_t)&handler<5>};
+    _instances[_nSlot] = this;
+    NVIC_SetVector(_irq, handlers[_nSlot]);
+    NVIC_EnableIRQ(_irq);
+
+    _tim->DIER = TIM_DIER_CC3IE | TIM_DIER_CC4IE;
+    _tim->CR1 = TIM_CR1_CEN;
+
+    _SpeedTimer.reset();
+    _SpeedTimer.start();
+}
+
+QEITimer::~QEITimer()
+{
+    _tim->DIER = 0;
+    _tim->CR1 &= ~TIM_CR1_CEN;
+    NVIC_DisableIRQ(_irq);
+    _instances[_nSlot] = NULL;
+}
+
+void QEITimer::update()
+{
+    uint16_t count = (uint16_t)_tim->CNT;
+    _nPulses += (int16_t)(uint16_t)(count - _nLastCount);
+    _nLastCount = count;
+
+    //The counter moves one count at a time, so it matches one of these
+    //before it gets QEI_TIMER_GUARD + 1 counts away.
+    _tim->CCR3 = (uint16_t)(count + QEI_TIMER_GUARD);
+    _tim->CCR4 = (uint16_t)(count - QEI_TIMER_GUARD);
+}
+
+void QEITimer::irq()
+{
+    //The flags are rc_w0, a match after the update gets its own interrupt.
+    _tim->SR = ~(TIM_SR_CC3IF | TIM_SR_CC4IF);
+    update();
+}
+
+void QEITimer::reset()
+{
+    write64(0);
+}
+
+int QEITimer::read()
+{
+    return (int)read64();
+}
+
+void QEITimer::write(int pulses)
+{
+    write64(pulses);
+}
+
+int64_t QEITimer::read64()
+{
+    int64_t pulses;
+
+    __disable_irq();
+    update();
+    pulses = _nPulses;
+    __enable_irq();
+
+    return pulses;
+}
+
+void QEITimer::write64(int64_t pulses)
+{
+    __disable_irq();
+    update();
+    _nPulses = pulses;
+    __enable_irq();
+}
+
+void QEITimer::setSpeedFactor(float fSpeedFactor)
+{
+    _fSpeedFactor = fSpeedFactor;
+}
+
+float QEITimer::getSpeed()
+{
+    int64_t pulses = read64();
+    us_timestamp_t act = _SpeedTimer.read_high_resolution_us();
+    us_timestamp_t diff = act - _nSpeedLastTimer;
+
+    if (diff > 0)
+    {
+        _fSpeed = 1000000.0f * _fSpeedFactor * (float)(pulses - _nSpeedLastPulses) / (float)diff;
+        _nSpeedLastTimer = act;
+        _nSpeedLastPulses = pulses;
+    }
+
+    return _fSpeed;
+}
+
+void QEITimer::setPositionFactor(float fPositionFactor)
+{
+    _fPositionFactor = fPositionFactor;
+}
+
+float QEITimer::getPosition()
+{
+    return (float)read64() * _fPositionFactor;
+}
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * Quadrature Encoder Interface using an STM32 timer in encoder mode.
+ *
+ * The timer counts the channel A/B edges in hardware (TIMx_SMCR SMS=011 for
+ * X4 encoding), so no interrupt runs per edge and the count keeps up with edge
+ * rates far above what InterruptIn can service.
+ *
+ * Channel A must be wired to channel 1 and channel B to channel 2 of the same
+ * general purpose or advanced timer, as listed in the target's PinMap_PWM.
+ *
+ * The hardware counter is 16 bits wide and is extended in software. Compare
+ * channels 3 and 4 are kept QEI_TIMER_GUARD counts above and below the last
+ * extended count, and their interrupt extends the count again before the
+ * counter can move far enough to be ambiguous. So the count stays right
+ * without ever being read, at the cost of one interrupt per QEI_TIMER_GUARD
+ * counts at most. The interrupt latency must stay below 32767 - QEI_TIMER_GUARD
+ * counts.
+ */
+
+#ifndef _QEI_TIMER_H_
+#define _QEI_TIMER_H_
+
+#include "mbed.h"
+#include "QEIDecoder.h"
+
+#if defined(TARGET_STM)
+
+#define QEI_TIMER_TIMERS 6    //TIM1 to TIM5 and TIM8
+#define QEI_TIMER_GUARD 0x2000 //Counts between the compare interrupts
+
+/**
+ * Quadrature Encoder Interface using an STM32 timer in encoder mode.
+ */
+class QEITimer
+{
+
+public:
+    /**
+     * Contructor
+     * Configures the timer of the two pins in encoder mode and starts it.
+     * 
+     * @param channelA mbed pin for channel A input, timer channel 1
+     * @param channelB mbed pin for channel B input, timer channel 2
+     * @param encoding The encoding to use. X2 counts both edges of channel A only.
+     * @param nFilter Timer input filter, 0 (off) to 15, see ICxF in the reference manual.
+     */
+    QEITimer(PinName channelA, PinName channelB, QEIDecoder::Encoding encoding = QEIDecoder::X4_ENCODING, int nFilter = 0);
+
+    /**
+     * Destructor
+     * Stops the timer and its interrupt.
+     */
+    ~QEITimer();
+
+    /**
+     * Reset the encoder.
+     * 
+     * Sets the pulses count to zero.
+     */
+    void reset();
+
+    /**
+     * Read the number of pulses recorded by the encoder.
+     * @return Number of pulses which have occured.
+     */
+    int read();
+
+    /**
+     * Sets the number of pulses
+     * @param pulses Number of pulses which to set.
+     */
+    void write(int pulses);
+
+    /**
+     * Read the extended number of pulses recorded by the encoder.
+     * @return Number of pulses which have occured.
+     */
+    int64_t read64();
+
+    /**
+     * Sets the extended number of pulses
+     * @param pulses Number of pulses which to set.
+     */
+    void write64(int64_t pulses);
+
+    /**
+     * Sets the factor for the getter-functions to convert in another unit.
+     * (1.0=Hz, 1/(X*CPR)=rps, 1/(60*X*CPR)=rpm, 360/(X*CPR)=°/s)
+     * Where X is encoding type [e.g. X4 encoding => X=4]
+     * @param fSpeedFactor - factor to scale from Hz to user unit
+     */
+    void setSpeedFactor(float fSpeedFactor);
+
+    /**
+     * Gets the speed as float value.
+     * The speed is the pulse count change since the previous call divided by the elapsed time.
+     * @return speed The value is scales by the factor set by setSpeedFactor()
+     */
+    float getSpeed();
+
+    /**
+     * Sets the factor for the getter-functions to convert in another unit.
+     * (1.0=Count, 1/(X*CPR)=revolution, 360/(X*CPR)=deg, (2*pi)/(X*CPR)=rad)
+     * Where X is encoding type [e.g. X4 encoding => X=4]
+     * @param fPositionFactor - factor to scale from counts to user unit
+     */
+    void setPositionFactor(float fPositionFactor);
+
+    /**
+     * Gets the position as float value.
+     * @return position The value is scales by the factor set by setPositionFactor()
+     */
+    float getPosition();
+
+protected:
+    /**
+     * Fold the hardware counter change since the last call into _nPulses
+     * and move the compare channels around the new count.
+     * Called with the interrupts disabled or from the interrupt.
+     */
+    void update();
+
+    /**
+     * Compare interrupt, the counter moved QEI_TIMER_GUARD counts.
+     */
+    void irq();
+
+    template <int N>
+    static void handler();
+
+    static QEITimer *_instances[QEI_TIMER_TIMERS];
+
+    TIM_TypeDef *_tim;
+    IRQn_Type _irq;
+    int _nSlot;
+
+    uint16_t _nLastCount;
+    int64_t _nPulses;
+
+    float _fSpeedFactor;
+    float _fPositionFactor;
+
+    Timer _SpeedTimer;
+
+    us_timestamp_t _nSpeedLastTimer;
+    int64_t _nSpeedLastPulses;
+    float _fSpeed;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,88 @@
+#include "QEITrace.h"
+
+static const uint8_t traceMagic[4] = {'Q', 'E', 'I', 'T'};
+
+QEITraceWriter::QEITraceWriter(uint8_t *buffer, size_t capacity)
+{
+    _buffer = buffer;
+    _nCapacity = capacity;
+    _nSize = 0;
+    _nTime = 0;
+
+    if (capacity >= QEI_TRACE_HEADER)
+    {
+        for (int i = 0; i < 4; i++)
+            _buffer[i] = traceMagic[i];
+        _buffer[4] = QEI_TRACE_VERSION;
+        _nSize = QEI_TRACE_HEADER;
+    }
+}
+
+bool QEITraceWriter::add(uint64_t time, int state, bool index)
+{
+    if (_nSize < QEI_TRACE_HEADER || time < _nTime)
+        return false;
+
+    uint64_t value = ((time - _nTime) << 3) | ((uint64_t)index << 2) | (uint64_t)(state & 3);
+
+    //Encode into a scratch first so a full buffer leaves the trace intact.
+    uint8_t bytes[10];
+    size_t length = 0;
+    do
+    {
+        bytes[length] = value & 0x7F;
+        value >>= 7;
+        if (value != 0)
+            bytes[length] |= 0x80;
+        length++;
+    } while (value != 0);
+
+    if (_nCapacity - _nSize < length)
+        return false;
+
+    for (size_t i = 0; i < length; i++)
+        _buffer[_nSize++] = bytes[i];
+    _nTime = time;
+    return true;
+}
+
+QEITraceReader::QEITraceReader(const uint8_t *trace, size_t size)
+{
+    _trace = trace;
+    _nSize = size;
+    _nOffset = QEI_TRACE_HEADER;
+    _nTime = 0;
+    _bError = false;
+
+    _bValid = size >= QEI_TRACE_HEADER && trace[4] == QEI_TRACE_VERSION;
+    for (int i = 0; _bValid && i < 4; i++)
+        _bValid = trace[i] == traceMagic[i];
+}
+
+bool QEITraceReader::next(QEITraceEvent &event)
+{
+    if (!_bValid || _bError || _nOffset >= _nSize)
+        return false;
+
+    uint64_t value = 0;
+    unsigned int shift = 0;
+    uint8_t byte;
+    do
+    {
+        //Truncated, or more than the 10 bytes a 64-bit varint can have.
+        if (_nOffset >= _nSize || shift > 63)
+        {
+            _bError = true;
+            return false;
+        }
+        byte = _trace[_nOffset++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    _nTime += value >> 3;
+    event.time = _nTime;
+    event.state = value & 3;
+    event.index = (value & 4) != 0;
+    return true;
+}
@@ -0,0 +1,124 @@
+/**
+ * Compact binary trace of encoder edges.
+ *
+ * A trace starts with the 4 bytes "QEIT" and a version byte, followed by one
+ * record per event. A record is a single unsigned LEB128 varint of
+ *
+ *   (dt << 3) | (index << 2) | state
+ *
+ * where dt is the time since the previous record in microseconds, state the
+ * 2-bit state (A << 1) | B after the event and index set for an index pulse.
+ * Edges a few microseconds apart take one byte, a second apart three bytes.
+ * The first record carries the initial state, its dt is the trace start time.
+ *
+ * Logic-analyzer exports are converted with QEITraceWriter, QEIReplay feeds
+ * a trace back through the decoder.
+ *
+ * Only depends on <stdint.h> and <stddef.h>.
+ */
+
+#ifndef _QEI_TRACE_H_
+#define _QEI_TRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define QEI_TRACE_VERSION 1
+#define QEI_TRACE_HEADER 5 //Magic and version bytes before the first record
+
+/**
+ * One trace record.
+ */
+typedef struct QEITraceEvent
+{
+    uint64_t time; //Microseconds since the trace start
+    uint8_t state; //2-bit state after the event, (A << 1) | B
+    bool index;    //Index pulse, the state is unchanged
+} QEITraceEvent;
+
+/**
+ * Writes a trace into a caller supplied buffer.
+ */
+class QEITraceWriter
+{
+
+public:
+    /**
+     * Contructor
+     * Writes the header.
+     * @param buffer Storage for the trace.
+     * @param capacity Size of buffer in bytes.
+     */
+    QEITraceWriter(uint8_t *buffer, size_t capacity);
+
+    /**
+     * Append a record.
+     * @param time Time of the event in microseconds, not before the previous one.
+     * @param state 2-bit state after the event.
+     * @param index true for an index pulse.
+     * @return false if the buffer is full or time went backwards, the trace is unchanged.
+     */
+    bool add(uint64_t time, int state, bool index = false);
+
+    /**
+     * @return Bytes written, including the header.
+     */
+    size_t size() const
+    {
+        return _nSize;
+    }
+
+protected:
+    uint8_t *_buffer;
+    size_t _nCapacity;
+    size_t _nSize;
+    uint64_t _nTime; //Time of the last record
+};
+
+/**
+ * Reads the records of a trace in order.
+ */
+class QEITraceReader
+{
+
+public:
+    /**
+     * Contructor
+     * @param trace Trace including the header.
+     * @param size Size of trace in bytes.
+     */
+    QEITraceReader(const uint8_t *trace, size_t size);
+
+    /**
+     * @return true if the header matches this version.
+     */
+    bool isValid() const
+    {
+        return _bValid;
+    }
+
+    /**
+     * Read the next record.
+     * @param event Filled with the record.
+     * @return false at the end of the trace, or on a truncated or overlong record.
+     */
+    bool next(QEITraceEvent &event);
+
+    /**
+     * @return true if reading stopped on a malformed record instead of the end.
+     */
+    bool hasError() const
+    {
+        return _bError;
+    }
+
+protected:
+    const uint8_t *_trace;
+    size_t _nSize;
+    size_t _nOffset;
+    uint64_t _nTime;
+    bool _bValid;
+    bool _bError;
+};
+
+#endif
@@ -0,0 +1,250 @@
+/**
+ * Host benchmark of the QEI edge interrupt.
+ *
+ * Calls the encode() interrupt handlers directly with the pins already set,
+ * so only the decoding is timed, and reports nanoseconds per call. Then
+ * compares a QEIBank of 16 encoders on one port with 16 scalar encode()
+ * calls, and reports the QEIProfiler cost of the edge interrupt and every
+ * getter for both encodings and the synthetic rotation patterns.
+ *
+ * Usage: qei_bench [iterations]
+ */
+
+#include "mbed.h"
+#include "QEI.h"
+#include "QEIBank.h"
+#include "QEIProfiler.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef std::chrono::steady_clock BenchClock;
+
+static const int forwardStates[4] = {0x0, 0x1, 0x3, 0x2};
+
+class BenchQEI : public QEI
+{
+
+public:
+    BenchQEI(Encoding encoding, PinName channelA = 0, PinName channelB = 1) : QEI(channelA, channelB, NC, encoding) {}
+
+    using QEI::encode;
+};
+
+class BenchQEIX4 : public QEIT<QEI::X4_ENCODING>
+{
+
+public:
+    BenchQEIX4() : QEIT<QEI::X4_ENCODING>(0, 1, NC) {}
+
+    using QEIT<QEI::X4_ENCODING>::encode;
+};
+
+static void setState(int state)
+{
+    host_pin_set(0, (state >> 1) & 1);
+    host_pin_set(1, state & 1);
+}
+
+//X2 only interrupts on channel A, so it only sees every second state.
+template <typename T>
+static double benchEncode(T &encoder, int nStride, long iterations)
+{
+    volatile int sink;
+
+    BenchClock::time_point start = BenchClock::now();
+    for (long i = 0; i < iterations; i++)
+    {
+        setState(forwardStates[(i * nStride + nStride) & 3]);
+        encoder.encode();
+    }
+    BenchClock::time_point end = BenchClock::now();
+
+    sink = encoder.read();
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double)iterations;
+}
+
+#define BENCH_AXES 16
+
+class BenchBank : public QEIBank<BENCH_AXES>
+{
+
+public:
+    BenchBank(const uint8_t bitsA[BENCH_AXES], const uint8_t bitsB[BENCH_AXES]) : QEIBank<BENCH_AXES>(PortA, bitsA, bitsB) {}
+
+    using QEIBank<BENCH_AXES>::update;
+    using QEIBank<BENCH_AXES>::_bPacked;
+};
+
+//Port words with every encoder one forward state further than in the previous word.
+static void forwardWords(const uint8_t *bitsA, const uint8_t *bitsB, uint32_t words[4])
+{
+    for (int step = 0; step < 4; step++)
+    {
+        words[step] = 0;
+        for (int i = 0; i < BENCH_AXES; i++)
+            words[step] |= ((uint32_t)(forwardStates[step] >> 1) << bitsA[i]) | ((uint32_t)(forwardStates[step] & 1) << bitsB[i]);
+    }
+}
+
+static double benchPortSet(const uint32_t words[4], long iterations)
+{
+    BenchClock::time_point start = BenchClock::now();
+    for (long i = 0; i < iterations; i++)
+        host_port_set(PortA, words[(i + 1) & 3]);
+    BenchClock::time_point end = BenchClock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double)iterations;
+}
+
+//One update() for all encoders, minus setting the port.
+static double benchBank(const uint8_t *bitsA, const uint8_t *bitsB, bool &bPacked, long iterations)
+{
+    uint32_t words[4];
+    forwardWords(bitsA, bitsB, words);
+    host_port_set(PortA, words[0]);
+    BenchBank bank(bitsA, bitsB);
+    bPacked = bank._bPacked;
+
+    BenchClock::time_point start = BenchClock::now();
+    for (long i = 0; i < iterations; i++)
+    {
+        host_port_set(PortA, words[(i + 1) & 3]);
+        bank.update();
+    }
+    BenchClock::time_point end = BenchClock::now();
+
+    if (bank[BENCH_AXES - 1].read() != iterations)
+        printf("QEIBank miscounted: %d\n", bank[BENCH_AXES - 1].read());
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double)iterations - benchPortSet(words, iterations);
+}
+
+//One encode() per encoder, minus setting the port.
+static double benchScalar(const uint8_t *bitsA, const uint8_t *bitsB, long iterations)
+{
+    uint32_t words[4];
+    forwardWords(bitsA, bitsB, words);
+    host_port_set(PortA, words[0]);
+    BenchQEI *encoders[BENCH_AXES];
+    for (int i = 0; i < BENCH_AXES; i++)
+        encoders[i] = new BenchQEI(QEI::X4_ENCODING, port_pin(PortA, bitsA[i]), port_pin(PortA, bitsB[i]));
+
+    BenchClock::time_point start = BenchClock::now();
+    for (long i = 0; i < iterations; i++)
+    {
+        host_port_set(PortA, words[(i + 1) & 3]);
+        for (int e = 0; e < BENCH_AXES; e++)
+            encoders[e]->encode();
+    }
+    BenchClock::time_point end = BenchClock::now();
+
+    if (encoders[BENCH_AXES - 1]->read() != iterations)
+        printf("QEI miscounted: %d\n", encoders[BENCH_AXES - 1]->read());
+    for (int i = 0; i < BENCH_AXES; i++)
+        delete encoders[i];
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double)iterations - benchPortSet(words, iterations);
+}
+
+static void benchBanks(long iterations)
+{
+    uint8_t oddA[BENCH_AXES], evenB[BENCH_AXES], evenA[BENCH_AXES], oddB[BENCH_AXES], lowA[BENCH_AXES], highB[BENCH_AXES];
+    for (int i = 0; i < BENCH_AXES; i++)
+    {
+        oddA[i] = (uint8_t)(2 * i + 1);
+        evenB[i] = (uint8_t)(2 * i);
+        evenA[i] = (uint8_t)(2 * i);
+        oddB[i] = (uint8_t)(2 * i + 1);
+        lowA[i] = (uint8_t)i;
+        highB[i] = (uint8_t)(i + BENCH_AXES);
+    }
+
+    static const struct
+    {
+        const char *name;
+        const uint8_t *bitsA;
+        const uint8_t *bitsB;
+    } layouts[3] = {
+        {"A on odd bits", oddA, evenB},
+        {"A on even bits", evenA, oddB},
+        {"A on 0-15, B on 16-31", lowA, highB},
+    };
+
+    printf("\n%d encoders moving together, ns per port change\n", BENCH_AXES);
+    for (int l = 0; l < 3; l++)
+    {
+        bool bPacked;
+        double bank = benchBank(layouts[l].bitsA, layouts[l].bitsB, bPacked, iterations);
+        double scalar = benchScalar(layouts[l].bitsA, layouts[l].bitsB, iterations);
+        printf("  %-24s QEIBank (%s) %8.2f   %d x QEI encode() %8.2f\n", layouts[l].name, bPacked ? "packed" : "tables", bank, BENCH_AXES, scalar);
+    }
+}
+
+static void profileMethods(QEI::Encoding encoding, const char *encodingName, long iterations)
+{
+    static const struct
+    {
+        const char *name;
+        const uint8_t *states;
+    } patterns[4] = {
+        {"forward", QEI_PATTERN_FORWARD},
+        {"backward", QEI_PATTERN_BACKWARD},
+        {"jitter", QEI_PATTERN_JITTER},
+        {"invalid", QEI_PATTERN_INVALID},
+    };
+
+    QEIProfile report[4][QEI_PROFILE_METHODS];
+    for (int p = 0; p < 4; p++)
+    {
+        QEIProfiler profiler(encoding);
+        profiler.run(patterns[p].states, 4, (unsigned int)iterations, report[p]);
+    }
+
+    char title[64];
+    snprintf(title, sizeof(title), "%s, %s per call", encodingName, QEICycleCounter::getUnit());
+    printf("\n%-42s", title);
+    for (int p = 0; p < 4; p++)
+        printf("%10s", patterns[p].name);
+    printf("\n");
+
+    for (int m = 0; m < QEI_PROFILE_METHODS; m++)
+    {
+        printf("  %-40s", QEI_PROFILE_METHOD_NAMES[m]);
+        for (int p = 0; p < 4; p++)
+        {
+            if (report[p][m].calls > 0)
+                printf("%10.1f", (double)report[p][m].total / report[p][m].calls);
+            else
+                printf("%10s", "-");
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 10000000;
+
+    setState(0);
+    BenchQEI encoderX4(QEI::X4_ENCODING);
+    printf("QEI X4 encode():          %6.2f ns\n", benchEncode(encoderX4, 1, iterations));
+
+    setState(0);
+    BenchQEI encoderX2(QEI::X2_ENCODING);
+    printf("QEI X2 encode():          %6.2f ns\n", benchEncode(encoderX2, 2, iterations));
+
+    setState(0);
+    BenchQEIX4 encoderT;
+    printf("QEIT<X4> encode():        %6.2f ns\n", benchEncode(encoderT, 1, iterations));
+
+    benchBanks(iterations / 10);
+
+    //Per call measurements, the clock read is included in every number.
+    QEIProfile overhead = QEIProfiler::overhead(100000);
+    printf("\nmeasurement overhead: %.1f %s\n", (double)overhead.total / overhead.calls, QEICycleCounter::getUnit());
+    profileMethods(QEI::X4_ENCODING, "X4", iterations / 10);
+    profileMethods(QEI::X2_ENCODING, "X2", iterations / 10);
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * Host benchmark of QEIObserver against the M/T speed estimator.
+ *
+ * Builds edge traces of known motion profiles with QEITraceWriter, with a
+ * few microseconds of edge jitter as a logic analyzer would record, and
+ * replays each through QEIReplay. At every 1 ms speed sample the M/T
+ * estimate from getSpeed() and the observer, updated at the same rate, are
+ * compared with the true speed, and the observer position with the true
+ * position. Reports RMS and maximum errors after the first 100 ms. The
+ * observer position after update() is its prediction for the next update,
+ * so it leads the true position by up to one period of travel.
+ *
+ * Usage: qei_observer_bench [bandwidth Hz]...
+ */
+
+#include "mbed.h"
+#include "QEIReplay.h"
+#include "QEIObserver.h"
+#include "QEITrace.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_PERIOD 1000    //Speed and observer period, us
+#define BENCH_SETTLE 100000  //Samples before this are not scored, us
+#define BENCH_DURATION 1200000
+
+typedef struct
+{
+    const char *name;
+    double (*speed)(double t); //True speed in counts per second at t seconds
+} BenchProfile;
+
+static double slowSpeed(double t)
+{
+    (void)t;
+    return 40.0;
+}
+
+static double rampSpeed(double t)
+{
+    return 20000.0 * ((t < 0.6) ? t / 0.6 : (1.2 - t) / 0.6);
+}
+
+static double sineSpeed(double t)
+{
+    return 5000.0 * sin(2.0 * M_PI * 2.0 * t);
+}
+
+static double stopSpeed(double t)
+{
+    if (t < 0.4)
+        return 3000.0;
+    if (t < 0.8)
+        return 0.0;
+    return -3000.0;
+}
+
+static const BenchProfile profiles[] = {
+    {"constant 40/s", slowSpeed},
+    {"ramp 0-20k-0/s", rampSpeed},
+    {"sine 5k/s at 2 Hz", sineSpeed},
+    {"3k/s, stop, -3k/s", stopSpeed},
+};
+
+static size_t makeTrace(const BenchProfile &profile, std::vector<uint8_t> &trace)
+{
+    static const int forward[4] = {0x0, 0x1, 0x3, 0x2};
+
+    trace.resize(4 * 1024 * 1024);
+    QEITraceWriter writer(&trace[0], trace.size());
+    writer.add(0, forward[0]);
+
+    double position = 0;
+    int64_t count = 0;
+    uint64_t last = 0;
+    uint32_t noise = 12345;
+    for (uint64_t t = 1; t <= BENCH_DURATION; t++)
+    {
+        position += profile.speed((double)t * 1e-6) * 1e-6;
+        int64_t next = (int64_t)floor(position);
+        while (count != next)
+        {
+            count += (next > count) ? 1 : -1;
+
+            //0 to 3 us of jitter, never reordering edges.
+            noise = noise * 1103515245u + 12345u;
+            uint64_t time = t + ((noise >> 16) & 3);
+            last = (time > last) ? time : last;
+            writer.add(last, forward[count & 3]);
+        }
+    }
+    return writer.size();
+}
+
+class BenchComparison
+{
+
+public:
+    BenchComparison(QEIReplay &replay, const BenchProfile &profile, float fBandwidth) : _observer(replay, fBandwidth, BENCH_PERIOD * 1e-6f), _profile(profile)
+    {
+        _nSamples = 0;
+        _fMTSquare = _fMTMax = 0;
+        _fObsSquare = _fObsMax = 0;
+        _fPosSquare = _fPosMax = 0;
+        _fPosition = 0;
+        _nTime = 0;
+    }
+
+    void sample(us_timestamp_t time, float speed)
+    {
+        _observer.update();
+
+        //True position integrated alongside the samples.
+        for (; _nTime < time; _nTime++)
+            _fPosition += _profile.speed((double)_nTime * 1e-6) * 1e-6;
+
+        if (time < BENCH_SETTLE)
+            return;
+
+        double truth = _profile.speed((double)time * 1e-6);
+        double mtError = fabs(speed - truth);
+        double obsError = fabs(_observer.getSpeed() - truth);
+        double posError = fabs(_observer.getPosition() - _fPosition);
+
+        _nSamples++;
+        _fMTSquare += mtError * mtError;
+        _fObsSquare += obsError * obsError;
+        _fPosSquare += posError * posError;
+        _fMTMax = (mtError > _fMTMax) ? mtError : _fMTMax;
+        _fObsMax = (obsError > _fObsMax) ? obsError : _fObsMax;
+        _fPosMax = (posError > _fPosMax) ? posError : _fPosMax;
+    }
+
+    void print(const char *name, float fBandwidth)
+    {
+        double n = (_nSamples > 0) ? _nSamples : 1;
+        printf("  %-20s %6.0f %12.1f %10.1f %12.1f %10.1f %10.3f %8.3f\n", name, fBandwidth,
+               sqrt(_fMTSquare / n), _fMTMax, sqrt(_fObsSquare / n), _fObsMax, sqrt(_fPosSquare / n), _fPosMax);
+    }
+
+private:
+    QEIObserver _observer;
+    const BenchProfile &_profile;
+    unsigned int _nSamples;
+    double _fMTSquare, _fMTMax;
+    double _fObsSquare, _fObsMax;
+    double _fPosSquare, _fPosMax;
+    double _fPosition;
+    us_timestamp_t _nTime;
+};
+
+int main(int argc, char **argv)
+{
+    std::vector<float> bandwidths;
+    for (int i = 1; i < argc; i++)
+        bandwidths.push_back((float)atof(argv[i]));
+    if (bandwidths.empty())
+    {
+        bandwidths.push_back(10.0f);
+        bandwidths.push_back(30.0f);
+        bandwidths.push_back(100.0f);
+    }
+
+    printf("speed error in counts/s, position error in counts, %d us period\n", BENCH_PERIOD);
+    printf("  %-20s %6s %12s %10s %12s %10s %10s %8s\n", "profile", "bw Hz", "M/T rms", "M/T max", "observer rms", "max", "pos rms", "max");
+
+    std::vector<uint8_t> trace;
+    for (unsigned int p = 0; p < sizeof(profiles) / sizeof(profiles[0]); p++)
+    {
+        size_t size = makeTrace(profiles[p], trace);
+        for (unsigned int b = 0; b < bandwidths.size(); b++)
+        {
+            QEIReplay replay(QEI::X4_ENCODING);
+            BenchComparison comparison(replay, profiles[p], bandwidths[b]);
+            QEIReplayResult result;
+            replay.run(&trace[0], size, BENCH_PERIOD, result, Callback<void(us_timestamp_t, float)>(&comparison, &BenchComparison::sample));
+            comparison.print(profiles[p].name, bandwidths[b]);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+/**
+ * Host stand-in for the mbed GPIO HAL, on the pin table of mbed.h.
+ */
+
+#ifndef _QEI_HOST_GPIO_API_H_
+#define _QEI_HOST_GPIO_API_H_
+
+#include "mbed.h"
+
+typedef struct
+{
+    PinName pin;
+} gpio_t;
+
+inline void gpio_init(gpio_t *obj, PinName pin)
+{
+    obj->pin = pin;
+}
+
+inline void gpio_init_out_ex(gpio_t *obj, PinName pin, int value)
+{
+    obj->pin = pin;
+    host_pin_write(pin, value);
+}
+
+inline int gpio_read(gpio_t *obj)
+{
+    return host_pin_read(obj->pin);
+}
+
+inline void gpio_write(gpio_t *obj, int value)
+{
+    host_pin_write(obj->pin, value);
+}
+
+#endif
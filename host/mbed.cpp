@@ -0,0 +1,320 @@
+#include "mbed.h"
+
+#include <chrono>
+
+static us_timestamp_t hostTime = 0;
+static int hostPins[HOST_PINS];
+static InterruptIn *firstInterrupt = NULL;
+static Ticker *firstTicker = NULL;
+static unsigned int hostNcHandlers = 0;
+
+us_timestamp_t host_time_us()
+{
+    return hostTime;
+}
+
+void host_advance_us(us_timestamp_t us)
+{
+    us_timestamp_t end = hostTime + us;
+
+    //Run the earliest due Ticker until none is due before the end.
+    for (;;)
+    {
+        Ticker *earliest = NULL;
+        for (Ticker *ticker = Ticker::first(); ticker != NULL; ticker = ticker->next())
+        {
+            if (ticker->deadline() <= end && (earliest == NULL || ticker->deadline() < earliest->deadline()))
+                earliest = ticker;
+        }
+        if (earliest == NULL)
+            break;
+
+        hostTime = earliest->deadline();
+        earliest->due(hostTime);
+    }
+
+    hostTime = end;
+}
+
+unsigned int host_nc_handlers()
+{
+    return hostNcHandlers;
+}
+
+us_timestamp_t host_clock_us()
+{
+    return (us_timestamp_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t host_cycle_read()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int host_pin_read(PinName pin)
+{
+    MBED_ASSERT(pin >= 0 && pin < HOST_PINS);
+    return hostPins[pin];
+}
+
+void host_pin_set(PinName pin, int value)
+{
+    MBED_ASSERT(pin >= 0 && pin < HOST_PINS);
+    hostPins[pin] = value ? 1 : 0;
+}
+
+void host_pin_write(PinName pin, int value)
+{
+    MBED_ASSERT(pin >= 0 && pin < HOST_PINS);
+    value = value ? 1 : 0;
+    if (hostPins[pin] == value)
+        return;
+
+    hostPins[pin] = value;
+    for (InterruptIn *irq = InterruptIn::first(); irq != NULL; irq = irq->next())
+    {
+        if (irq->pin() == pin)
+            irq->edge(value);
+    }
+}
+
+void host_port_set(PortName port, uint32_t value)
+{
+    for (int bit = 0; bit < HOST_PORT_PINS; bit++)
+        hostPins[port_pin(port, bit)] = (value >> bit) & 1;
+}
+
+void host_port_write(PortName port, uint32_t value)
+{
+    uint32_t changed = 0;
+    for (int bit = 0; bit < HOST_PORT_PINS; bit++)
+    {
+        PinName pin = port_pin(port, bit);
+        int level = (value >> bit) & 1;
+        if (hostPins[pin] != level)
+            changed |= 1u << bit;
+        hostPins[pin] = level;
+    }
+
+    for (int bit = 0; bit < HOST_PORT_PINS; bit++)
+    {
+        if (!(changed & (1u << bit)))
+            continue;
+        for (InterruptIn *irq = InterruptIn::first(); irq != NULL; irq = irq->next())
+        {
+            if (irq->pin() == port_pin(port, bit))
+                irq->edge((value >> bit) & 1);
+        }
+    }
+}
+
+namespace mbed
+{
+
+InterruptIn::InterruptIn(PinName pin, PinMode mode) : _pin(pin)
+{
+    (void)mode;
+    _next = firstInterrupt;
+    firstInterrupt = this;
+}
+
+InterruptIn::~InterruptIn()
+{
+    for (InterruptIn **irq = &firstInterrupt; *irq != NULL; irq = &(*irq)->_next)
+    {
+        if (*irq == this)
+        {
+            *irq = _next;
+            break;
+        }
+    }
+}
+
+void InterruptIn::rise(Callback<void()> handler)
+{
+    if (_pin == NC)
+        hostNcHandlers++;
+    _rise = handler;
+}
+
+void InterruptIn::fall(Callback<void()> handler)
+{
+    if (_pin == NC)
+        hostNcHandlers++;
+    _fall = handler;
+}
+
+void InterruptIn::edge(int value)
+{
+    if (value && _rise)
+        _rise();
+    else if (!value && _fall)
+        _fall();
+}
+
+InterruptIn *InterruptIn::first()
+{
+    return firstInterrupt;
+}
+
+int PortIn::read()
+{
+    uint32_t value = 0;
+    for (int bit = 0; bit < HOST_PORT_PINS; bit++)
+        value |= (uint32_t)hostPins[port_pin(_port, bit)] << bit;
+    return (int)(value & _mask);
+}
+
+void Timer::start()
+{
+    if (!_bRunning)
+    {
+        _nStart = hostTime;
+        _bRunning = true;
+    }
+}
+
+void Timer::stop()
+{
+    if (_bRunning)
+    {
+        _nElapsed += hostTime - _nStart;
+        _bRunning = false;
+    }
+}
+
+void Timer::reset()
+{
+    _nStart = hostTime;
+    _nElapsed = 0;
+}
+
+us_timestamp_t Timer::read_high_resolution_us()
+{
+    return _nElapsed + (_bRunning ? hostTime - _nStart : 0);
+}
+
+int Timer::read_us()
+{
+    return (int)read_high_resolution_us();
+}
+
+float Timer::read()
+{
+    return (float)read_high_resolution_us() / 1000000.0f;
+}
+
+Ticker::Ticker() : _bOneShot(false), _nPeriod(0), _nDeadline(0), _bAttached(false)
+{
+    _next = firstTicker;
+    firstTicker = this;
+}
+
+Ticker::~Ticker()
+{
+    for (Ticker **ticker = &firstTicker; *ticker != NULL; ticker = &(*ticker)->_next)
+    {
+        if (*ticker == this)
+        {
+            *ticker = _next;
+            break;
+        }
+    }
+}
+
+void Ticker::attach_us(Callback<void()> handler, us_timestamp_t period)
+{
+    _handler = handler;
+    _nPeriod = (period > 0) ? period : 1;
+    _nDeadline = hostTime + _nPeriod;
+    _bAttached = true;
+}
+
+void Ticker::detach()
+{
+    _bAttached = false;
+}
+
+bool Ticker::due(us_timestamp_t time)
+{
+    if (!_bAttached || time < _nDeadline)
+        return false;
+    _nDeadline += _nPeriod;
+    if (_bOneShot)
+        _bAttached = false;
+    _handler();
+    return true;
+}
+
+Ticker *Ticker::first()
+{
+    return firstTicker;
+}
+
+} //namespace mbed
+
+namespace events
+{
+
+EventQueue::EventQueue() : _nNextId(1)
+{
+    for (int i = 0; i < HOST_EVENT_QUEUE; i++)
+        _events[i].id = 0;
+}
+
+int EventQueue::post(mbed::Callback<void()> function, int period)
+{
+    for (int i = 0; i < HOST_EVENT_QUEUE; i++)
+    {
+        if (_events[i].id == 0)
+        {
+            _events[i].id = _nNextId++;
+            _events[i].function = function;
+            _events[i].period = (us_timestamp_t)period * 1000;
+            _events[i].deadline = hostTime + _events[i].period;
+            return _events[i].id;
+        }
+    }
+    return 0;
+}
+
+bool EventQueue::cancel(int id)
+{
+    for (int i = 0; i < HOST_EVENT_QUEUE; i++)
+    {
+        if (id != 0 && _events[i].id == id)
+        {
+            _events[i].id = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+void EventQueue::dispatch(int ms)
+{
+    (void)ms;
+    for (int i = 0; i < HOST_EVENT_QUEUE; i++)
+    {
+        if (_events[i].id == 0 || _events[i].deadline > hostTime)
+            continue;
+
+        mbed::Callback<void()> function = _events[i].function;
+        if (_events[i].period == 0)
+        {
+            _events[i].id = 0;
+            function();
+            continue;
+        }
+
+        //Periodic calls catch up on every period that has passed.
+        int id = _events[i].id;
+        while (_events[i].id == id && _events[i].deadline <= hostTime)
+        {
+            _events[i].deadline += _events[i].period;
+            function();
+        }
+    }
+}
+
+} //namespace events
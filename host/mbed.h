@@ -0,0 +1,439 @@
+/**
+ * Host stand-in for the parts of mbed OS used by the QEI library.
+ *
+ * Only for building the library, tests and benchmarks on a PC. Pins are
+ * levels in a table, and a level change runs the handlers of the InterruptIns
+ * on that pin straight away, as if the edge interrupt had fired. Time only
+ * moves when host_advance_us() is called, which also runs the due Tickers.
+ * Interrupts never preempt anything, so the critical sections are empty.
+ *
+ * @code
+ * QEI encoder(0, 1, NC);
+ * host_advance_us(100);
+ * host_pin_write(1, 1); //Channel B leads, counts forward
+ * @endcode
+ */
+
+#ifndef _QEI_HOST_MBED_H_
+#define _QEI_HOST_MBED_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <functional>
+
+typedef uint64_t us_timestamp_t;
+
+typedef int PinName;
+#define NC ((PinName)-1)
+
+typedef enum PinMode
+{
+    PullNone,
+    PullUp,
+    PullDown
+} PinMode;
+
+typedef enum PortName
+{
+    PortA,
+    PortB,
+    PortC,
+    PortD
+} PortName;
+
+#define HOST_PORT_PINS 32 //Pins per port, pin numbers are port * 32 + bit
+#define HOST_PINS (4 * HOST_PORT_PINS)
+
+#define DEVICE_PORTIN 1
+
+#define MBED_ASSERT(expr) assert(expr)
+
+inline PinName port_pin(PortName port, int bit)
+{
+    return (PinName)(port * HOST_PORT_PINS + bit);
+}
+
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+inline void core_util_critical_section_enter() {}
+inline void core_util_critical_section_exit() {}
+
+//Sequentially consistent like mbed's, they order the plain accesses around them.
+inline uint32_t core_util_atomic_load_u32(const volatile uint32_t *valuePtr)
+{
+    return __atomic_load_n(valuePtr, __ATOMIC_SEQ_CST);
+}
+
+inline void core_util_atomic_store_u32(volatile uint32_t *valuePtr, uint32_t desiredValue)
+{
+    __atomic_store_n(valuePtr, desiredValue, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Simulated time in microseconds, see host_advance_us().
+ */
+us_timestamp_t host_time_us();
+
+/**
+ * Moves the simulated time forward, running the Ticker handlers due on the way.
+ * @param us Microseconds to advance.
+ */
+void host_advance_us(us_timestamp_t us);
+
+/**
+ * Sets a pin level and runs the rise or fall handlers attached to it if it changed.
+ */
+void host_pin_write(PinName pin, int value);
+
+/**
+ * Sets a pin level without running any handler, e.g. before calling a handler directly.
+ */
+void host_pin_set(PinName pin, int value);
+
+/**
+ * Gets a pin level.
+ */
+int host_pin_read(PinName pin);
+
+/**
+ * Sets all pins of a port at once, then runs the handlers of the changed pins.
+ */
+void host_port_write(PortName port, uint32_t value);
+
+/**
+ * Sets all pins of a port at once without running any handler.
+ */
+void host_port_set(PortName port, uint32_t value);
+
+/**
+ * Handlers set on an InterruptIn of NC so far. NC has no interrupt line, on
+ * STM32 setting them changes EXTI line 0 instead.
+ */
+unsigned int host_nc_handlers();
+
+/**
+ * Real monotonic clock for profiling, unlike the simulated time.
+ * @return Nanoseconds, wrapping at 32 bits.
+ */
+uint32_t host_cycle_read();
+#define HOST_CYCLE_COUNTER 1
+
+/**
+ * Real monotonic clock for longer runs, unlike the simulated time of Timer.
+ * @return Microseconds.
+ */
+us_timestamp_t host_clock_us();
+
+inline uint32_t us_ticker_read()
+{
+    return (uint32_t)host_time_us();
+}
+
+namespace mbed
+{
+
+template <typename F>
+class Callback;
+
+template <typename R, typename... A>
+class Callback<R(A...)>
+{
+
+public:
+    Callback() {}
+
+    Callback(R (*function)(A...))
+    {
+        if (function != NULL)
+            _function = function;
+    }
+
+    template <typename T>
+    Callback(T *object, R (T::*method)(A...))
+    {
+        _function = [object, method](A... args) { return (object->*method)(args...); };
+    }
+
+    R operator()(A... args) const
+    {
+        return _function(args...);
+    }
+
+    R call(A... args) const
+    {
+        return _function(args...);
+    }
+
+    explicit operator bool() const
+    {
+        return (bool)_function;
+    }
+
+private:
+    std::function<R(A...)> _function;
+};
+
+template <typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(U *object, R (T::*method)(A...))
+{
+    return Callback<R(A...)>(static_cast<T *>(object), method);
+}
+
+template <typename R, typename... A>
+Callback<R(A...)> callback(R (*function)(A...))
+{
+    return Callback<R(A...)>(function);
+}
+
+class InterruptIn
+{
+
+public:
+    InterruptIn(PinName pin, PinMode mode = PullNone);
+    ~InterruptIn();
+
+    int read()
+    {
+        return host_pin_read(_pin);
+    }
+
+    //Handlers set on NC are counted, see host_nc_handlers().
+    void rise(Callback<void()> handler);
+    void fall(Callback<void()> handler);
+
+    //Host only: runs the handler of a level change, see host_pin_write().
+    void edge(int value);
+
+    //Host only: attached InterruptIns, newest first.
+    static InterruptIn *first();
+    InterruptIn *next()
+    {
+        return _next;
+    }
+
+    PinName pin()
+    {
+        return _pin;
+    }
+
+private:
+    PinName _pin;
+    Callback<void()> _rise;
+    Callback<void()> _fall;
+    InterruptIn *_next;
+};
+
+class DigitalIn
+{
+
+public:
+    DigitalIn(PinName pin, PinMode mode = PullNone) : _pin(pin)
+    {
+        (void)mode;
+    }
+
+    int read()
+    {
+        return host_pin_read(_pin);
+    }
+
+private:
+    PinName _pin;
+};
+
+class DigitalOut
+{
+
+public:
+    DigitalOut(PinName pin, int value = 0) : _pin(pin)
+    {
+        write(value);
+    }
+
+    void write(int value)
+    {
+        host_pin_write(_pin, value);
+    }
+
+    int read()
+    {
+        return host_pin_read(_pin);
+    }
+
+private:
+    PinName _pin;
+};
+
+class PortIn
+{
+
+public:
+    PortIn(PortName port, int mask = 0xFFFFFFFF) : _port(port), _mask((uint32_t)mask) {}
+
+    int read();
+
+private:
+    PortName _port;
+    uint32_t _mask;
+};
+
+class Timer
+{
+
+public:
+    Timer() : _bRunning(false), _nStart(0), _nElapsed(0) {}
+
+    void start();
+    void stop();
+    void reset();
+    int read_us();
+    float read();
+    us_timestamp_t read_high_resolution_us();
+
+private:
+    bool _bRunning;
+    us_timestamp_t _nStart;
+    us_timestamp_t _nElapsed;
+};
+
+class Ticker
+{
+
+public:
+    Ticker();
+    ~Ticker();
+
+    void attach_us(Callback<void()> handler, us_timestamp_t period);
+    void detach();
+
+    //Host only: runs the handler if it is due at the time, see host_advance_us().
+    bool due(us_timestamp_t time);
+    static Ticker *first();
+    Ticker *next()
+    {
+        return _next;
+    }
+    us_timestamp_t deadline()
+    {
+        return _bAttached ? _nDeadline : (us_timestamp_t)-1;
+    }
+
+protected:
+    bool _bOneShot; //Timeout, detaches before running the handler
+
+private:
+    Callback<void()> _handler;
+    us_timestamp_t _nPeriod;
+    us_timestamp_t _nDeadline;
+    bool _bAttached;
+    Ticker *_next;
+};
+
+class Timeout : public Ticker
+{
+
+public:
+    Timeout()
+    {
+        _bOneShot = true;
+    }
+};
+
+} //namespace mbed
+
+namespace rtos
+{
+
+class EventFlags
+{
+
+public:
+    EventFlags() : _nFlags(0) {}
+
+    uint32_t set(uint32_t flags)
+    {
+        _nFlags |= flags;
+        return _nFlags;
+    }
+
+    uint32_t clear(uint32_t flags = 0x7FFFFFFF)
+    {
+        uint32_t previous = _nFlags;
+        _nFlags &= ~flags;
+        return previous;
+    }
+
+    uint32_t get() const
+    {
+        return _nFlags;
+    }
+
+private:
+    uint32_t _nFlags;
+};
+
+} //namespace rtos
+
+namespace events
+{
+
+#define HOST_EVENT_QUEUE 16 //Calls an EventQueue holds
+
+/**
+ * Queue of deferred calls, run by dispatch(0) on the host.
+ */
+class EventQueue
+{
+
+public:
+    EventQueue();
+
+    template <typename T, typename R>
+    int call(T *object, R (T::*method)())
+    {
+        return post(mbed::Callback<void()>(object, method), 0);
+    }
+
+    template <typename T, typename R>
+    int call_every(int ms, T *object, R (T::*method)())
+    {
+        return post(mbed::Callback<void()>(object, method), ms);
+    }
+
+    bool cancel(int id);
+
+    /**
+     * Runs the queued calls and the periodic calls due by host_time_us().
+     * @param ms Ignored, the host never waits.
+     */
+    void dispatch(int ms = -1);
+
+private:
+    int post(mbed::Callback<void()> function, int period);
+
+    struct Event
+    {
+        int id;
+        mbed::Callback<void()> function;
+        us_timestamp_t period;   //0 for a single call
+        us_timestamp_t deadline;
+    } _events[HOST_EVENT_QUEUE];
+    int _nNextId;
+};
+
+} //namespace events
+
+using namespace mbed;
+using namespace rtos;
+using namespace events;
+
+#if defined(TARGET_STM)
+#include "stm32_mock.h"
+#endif
+
+#endif
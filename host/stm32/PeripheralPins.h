@@ -0,0 +1,31 @@
+/**
+ * Host stand-in for the STM32 PeripheralPins.h.
+ *
+ * The timer pins, channel 1 then 2: TIM1 on PA_8/PA_9, TIM2 on PA_0/PA_1,
+ * TIM3 on PA_6/PA_7, TIM4 on PB_6/PB_7, TIM5 on PA_2/PA_3 and TIM8 on
+ * PC_6/PC_7. The function is the timer channel.
+ */
+
+#ifndef _QEI_HOST_PERIPHERAL_PINS_H_
+#define _QEI_HOST_PERIPHERAL_PINS_H_
+
+#include "pinmap.h"
+
+#define STM_PIN_CHANNEL(X) ((X) & 0x1F)
+
+#define PA_0 port_pin(PortA, 0)
+#define PA_1 port_pin(PortA, 1)
+#define PA_2 port_pin(PortA, 2)
+#define PA_3 port_pin(PortA, 3)
+#define PA_6 port_pin(PortA, 6)
+#define PA_7 port_pin(PortA, 7)
+#define PA_8 port_pin(PortA, 8)
+#define PA_9 port_pin(PortA, 9)
+#define PB_6 port_pin(PortB, 6)
+#define PB_7 port_pin(PortB, 7)
+#define PC_6 port_pin(PortC, 6)
+#define PC_7 port_pin(PortC, 7)
+
+extern const PinMap PinMap_PWM[];
+
+#endif
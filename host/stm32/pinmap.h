@@ -0,0 +1,32 @@
+/**
+ * Host stand-in for the mbed pinmap HAL, see PeripheralPins.h.
+ */
+
+#ifndef _QEI_HOST_PINMAP_H_
+#define _QEI_HOST_PINMAP_H_
+
+#include "mbed.h"
+
+typedef struct
+{
+    PinName pin;
+    int peripheral;
+    int function;
+} PinMap;
+
+uint32_t pinmap_peripheral(PinName pin, const PinMap *map);
+uint32_t pinmap_function(PinName pin, const PinMap *map);
+
+inline void pin_function(PinName pin, int function)
+{
+    (void)pin;
+    (void)function;
+}
+
+inline void pin_mode(PinName pin, PinMode mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+#endif
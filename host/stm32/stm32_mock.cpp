@@ -0,0 +1,222 @@
+#include "mbed.h"
+#include "PeripheralPins.h"
+
+#include <new>
+#include <sys/mman.h>
+
+#define HOST_TIMERS 8
+
+static TIM_TypeDef *hostTimers[HOST_TIMERS + 1];
+static uintptr_t hostVectors[HOST_IRQS];
+static bool hostEnabled[HOST_IRQS];
+
+static void setupTimer(TIM_TypeDef *tim, int n)
+{
+    bool wide = (n == 2 || n == 5);
+    tim->nWidthMask = wide ? 0xFFFFFFFF : 0xFFFF;
+
+    tim->SR.setup(0xFFFFFFFF, true);
+    tim->CNT.setup(tim->nWidthMask, false);
+    tim->ARR.setup(tim->nWidthMask, false);
+    tim->CCR1.setup(tim->nWidthMask, false, &tim->SR, TIM_SR_CC1IF);
+    tim->CCR2.setup(tim->nWidthMask, false, &tim->SR, TIM_SR_CC2IF);
+    tim->CCR3.setup(tim->nWidthMask, false);
+    tim->CCR4.setup(tim->nWidthMask, false);
+    tim->ARR.value = tim->nWidthMask;
+
+    switch (n)
+    {
+    case 1:
+        tim->nUpdateIrq = TIM1_UP_IRQn;
+        tim->nCompareIrq = TIM1_CC_IRQn;
+        break;
+    case 8:
+        tim->nUpdateIrq = TIM8_UP_IRQn;
+        tim->nCompareIrq = TIM8_CC_IRQn;
+        break;
+    default:
+        tim->nUpdateIrq = (IRQn_Type)(TIM2_IRQn + n - 2);
+        tim->nCompareIrq = tim->nUpdateIrq;
+        break;
+    }
+}
+
+TIM_TypeDef *host_tim(int n)
+{
+    MBED_ASSERT(n >= 1 && n <= HOST_TIMERS);
+    if (hostTimers[n] == NULL)
+    {
+        //Below 2 GB, so the address fits the int peripheral of a PinMap.
+        void *memory = mmap(NULL, sizeof(TIM_TypeDef), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+        MBED_ASSERT(memory != MAP_FAILED && (uintptr_t)memory < 0x80000000u);
+        hostTimers[n] = new (memory) TIM_TypeDef();
+        setupTimer(hostTimers[n], n);
+    }
+    return hostTimers[n];
+}
+
+void host_tim_reset()
+{
+    for (int n = 1; n <= HOST_TIMERS; n++)
+    {
+        if (hostTimers[n] != NULL)
+        {
+            hostTimers[n]->~TIM_TypeDef();
+            new (hostTimers[n]) TIM_TypeDef();
+            setupTimer(hostTimers[n], n);
+        }
+    }
+    for (int irq = 0; irq < HOST_IRQS; irq++)
+    {
+        hostVectors[irq] = 0;
+        hostEnabled[irq] = false;
+    }
+}
+
+static void runVector(IRQn_Type irq)
+{
+    if (hostEnabled[irq] && hostVectors[irq] != 0)
+        ((void (*)())hostVectors[irq])();
+}
+
+void host_tim_interrupt(TIM_TypeDef *tim)
+{
+    uint32_t pending = tim->SR.value & tim->DIER.value;
+
+    //TIM1 and TIM8 have their own update interrupt, the others one for all.
+    if (tim->nCompareIrq == tim->nUpdateIrq)
+    {
+        if (pending != 0)
+            runVector(tim->nCompareIrq);
+        return;
+    }
+    if (pending & TIM_SR_UIF)
+        runVector(tim->nUpdateIrq);
+    if (pending & ~TIM_SR_UIF)
+        runVector(tim->nCompareIrq);
+}
+
+void host_tim_count(TIM_TypeDef *tim, int counts)
+{
+    int direction = (counts < 0) ? -1 : 1;
+
+    for (int i = 0; i != counts; i += direction)
+    {
+        if (!(tim->CR1.value & TIM_CR1_CEN))
+            return;
+
+        uint32_t period = tim->ARR.value & tim->nWidthMask;
+        uint32_t count = tim->CNT.value;
+        if (direction > 0)
+            count = (count >= period) ? 0 : count + 1;
+        else
+            count = (count == 0) ? period : count - 1;
+        tim->CNT.value = count;
+
+        if (count == ((direction > 0) ? 0 : period))
+            tim->SR.value |= TIM_SR_UIF;
+        if (count == tim->CCR3.value)
+            tim->SR.value |= TIM_SR_CC3IF;
+        if (count == tim->CCR4.value)
+            tim->SR.value |= TIM_SR_CC4IF;
+
+        host_tim_interrupt(tim);
+    }
+}
+
+void host_tim_tick(TIM_TypeDef *tim, uint64_t ticks)
+{
+    if (!(tim->CR1.value & TIM_CR1_CEN))
+        return;
+
+    uint64_t period = (uint64_t)(tim->ARR.value & tim->nWidthMask) + 1;
+    uint64_t count = tim->CNT.value + ticks;
+    if (count >= period)
+        tim->SR.value |= TIM_SR_UIF;
+    tim->CNT.value = (uint32_t)(count % period);
+
+    host_tim_interrupt(tim);
+}
+
+void host_tim_capture(TIM_TypeDef *tim, int channel, bool bInterrupt)
+{
+    MBED_ASSERT(channel == 1 || channel == 2);
+    HostRegister &ccr = (channel == 1) ? tim->CCR1 : tim->CCR2;
+    uint32_t flag = (channel == 1) ? TIM_SR_CC1IF : TIM_SR_CC2IF;
+    uint32_t overcapture = (channel == 1) ? TIM_SR_CC1OF : TIM_SR_CC2OF;
+
+    if (tim->SR.value & flag)
+        tim->SR.value |= overcapture;
+    tim->SR.value |= flag;
+    ccr.value = tim->CNT.value;
+
+    if (bInterrupt)
+        host_tim_interrupt(tim);
+}
+
+void NVIC_SetVector(IRQn_Type irq, uintptr_t vector)
+{
+    hostVectors[irq] = vector;
+}
+
+uintptr_t NVIC_GetVector(IRQn_Type irq)
+{
+    return hostVectors[irq];
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+    hostEnabled[irq] = true;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq)
+{
+    hostEnabled[irq] = false;
+}
+
+void HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef *clkConfig, uint32_t *flashLatency)
+{
+    clkConfig->APB1CLKDivider = RCC_HCLK_DIV2;
+    *flashLatency = 0;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq()
+{
+    return 500000; //Timer clock twice that, 1 MHz
+}
+
+const PinMap PinMap_PWM[] = {
+    {PA_8, (int)(uintptr_t)TIM1, 1},
+    {PA_9, (int)(uintptr_t)TIM1, 2},
+    {PA_0, (int)(uintptr_t)TIM2, 1},
+    {PA_1, (int)(uintptr_t)TIM2, 2},
+    {PA_6, (int)(uintptr_t)TIM3, 1},
+    {PA_7, (int)(uintptr_t)TIM3, 2},
+    {PB_6, (int)(uintptr_t)TIM4, 1},
+    {PB_7, (int)(uintptr_t)TIM4, 2},
+    {PA_2, (int)(uintptr_t)TIM5, 1},
+    {PA_3, (int)(uintptr_t)TIM5, 2},
+    {PC_6, (int)(uintptr_t)TIM8, 1},
+    {PC_7, (int)(uintptr_t)TIM8, 2},
+    {NC, 0, 0}};
+
+static const PinMap *findPin(PinName pin, const PinMap *map)
+{
+    for (; map->pin != NC; map++)
+    {
+        if (map->pin == pin)
+            return map;
+    }
+    MBED_ASSERT(false);
+    return map;
+}
+
+uint32_t pinmap_peripheral(PinName pin, const PinMap *map)
+{
+    return (uint32_t)findPin(pin, map)->peripheral;
+}
+
+uint32_t pinmap_function(PinName pin, const PinMap *map)
+{
+    return (uint32_t)findPin(pin, map)->function;
+}
@@ -0,0 +1,231 @@
+/**
+ * Host register mock of the STM32 timers, for QEITimer and QEICapture.
+ *
+ * Included by the host mbed.h when TARGET_STM is defined. The timer registers
+ * behave like the hardware where the backends depend on it: the status flags
+ * are rc_w0, reading CCR1/CCR2 clears CC1IF/CC2IF, and TIM1, TIM3, TIM4 and
+ * TIM8 are 16 bits wide while TIM2 and TIM5 are 32 bits wide. The host_tim_*
+ * functions move a counter or latch a capture, set the flags the hardware
+ * would and run the timer interrupt set with NVIC_SetVector() if enabled.
+ *
+ * The timers live below 2 GB (MAP_32BIT), so their addresses fit in the
+ * uint32_t the pinmap returns, as they do on the target. The APB1 timer
+ * clock is 1 MHz, so a timer tick is a microsecond.
+ *
+ * @code
+ * QEITimer encoder(PA_6, PA_7); //TIM3
+ * host_tim_count(TIM3, 100000); //No read needed to keep the count
+ * @endcode
+ */
+
+#ifndef _QEI_HOST_STM32_MOCK_H_
+#define _QEI_HOST_STM32_MOCK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+/**
+ * A peripheral register.
+ * Reads and writes through the conversion and assignment operators have the
+ * hardware side effects, value is the raw content for the simulation.
+ */
+class HostRegister
+{
+
+public:
+    HostRegister() : value(0), nReads(0), _nMask(0xFFFFFFFF), _bClearOnWriteZero(false), _pClearOnRead(NULL), _nClearOnRead(0) {}
+
+    operator uint32_t()
+    {
+        nReads++;
+        uint32_t read = value;
+        if (_pClearOnRead != NULL)
+            _pClearOnRead->value &= ~_nClearOnRead;
+        if (onRead)
+            onRead();
+        return read;
+    }
+
+    HostRegister &operator=(uint32_t write)
+    {
+        if (_bClearOnWriteZero)
+            value &= write;
+        else
+            value = write & _nMask;
+        return *this;
+    }
+
+    HostRegister &operator|=(uint32_t bits)
+    {
+        return *this = (uint32_t)*this | bits;
+    }
+
+    HostRegister &operator&=(uint32_t bits)
+    {
+        return *this = (uint32_t)*this & bits;
+    }
+
+    //Host only: register set up, see host_tim().
+    void setup(uint32_t nMask, bool bClearOnWriteZero, HostRegister *pClearOnRead = NULL, uint32_t nClearOnRead = 0)
+    {
+        _nMask = nMask;
+        _bClearOnWriteZero = bClearOnWriteZero;
+        _pClearOnRead = pClearOnRead;
+        _nClearOnRead = nClearOnRead;
+    }
+
+    uint32_t value;
+    unsigned nReads;
+    std::function<void()> onRead; //Runs after each read, e.g. to race a capture
+
+private:
+    HostRegister(const HostRegister &);
+
+    uint32_t _nMask;
+    bool _bClearOnWriteZero;
+    HostRegister *_pClearOnRead;
+    uint32_t _nClearOnRead;
+};
+
+typedef enum IRQn
+{
+    TIM1_UP_IRQn,
+    TIM1_CC_IRQn,
+    TIM2_IRQn,
+    TIM3_IRQn,
+    TIM4_IRQn,
+    TIM5_IRQn,
+    TIM8_UP_IRQn,
+    TIM8_CC_IRQn,
+    HOST_IRQS
+} IRQn_Type;
+
+typedef struct
+{
+    HostRegister CR1;
+    HostRegister CR2;
+    HostRegister SMCR;
+    HostRegister DIER;
+    HostRegister SR;
+    HostRegister EGR;
+    HostRegister CCMR1;
+    HostRegister CCMR2;
+    HostRegister CCER;
+    HostRegister CNT;
+    HostRegister PSC;
+    HostRegister ARR;
+    HostRegister RCR;
+    HostRegister CCR1;
+    HostRegister CCR2;
+    HostRegister CCR3;
+    HostRegister CCR4;
+
+    //Host only
+    uint32_t nWidthMask; //0xFFFF or 0xFFFFFFFF
+    IRQn_Type nUpdateIrq;
+    IRQn_Type nCompareIrq;
+} TIM_TypeDef;
+
+/**
+ * @param n Timer number, 1 to 5 or 8.
+ * @return The mocked timer, all registers zero at the first call.
+ */
+TIM_TypeDef *host_tim(int n);
+
+#define TIM1 host_tim(1)
+#define TIM2 host_tim(2)
+#define TIM3 host_tim(3)
+#define TIM4 host_tim(4)
+#define TIM5 host_tim(5)
+#define TIM8 host_tim(8)
+
+/**
+ * Clears all registers of all timers, between tests.
+ */
+void host_tim_reset();
+
+/**
+ * Moves an encoder mode counter one count at a time, setting UIF on a wrap
+ * and CC3IF/CC4IF on a compare match, and runs the interrupt after each count.
+ * @param counts Counts to make, negative to count down.
+ */
+void host_tim_count(TIM_TypeDef *tim, int counts);
+
+/**
+ * Moves an up counting timer, setting UIF on a wrap, then runs the interrupt.
+ */
+void host_tim_tick(TIM_TypeDef *tim, uint64_t ticks);
+
+/**
+ * Latches the counter in CCR1 or CCR2 and sets CCxIF, or CCxOF when CCxIF
+ * is still set, like an input capture.
+ * @param channel 1 or 2
+ * @param bInterrupt Run the interrupt afterwards.
+ */
+void host_tim_capture(TIM_TypeDef *tim, int channel, bool bInterrupt = true);
+
+/**
+ * Runs the interrupts of the timer whose flags are set and enabled.
+ */
+void host_tim_interrupt(TIM_TypeDef *tim);
+
+void NVIC_SetVector(IRQn_Type irq, uintptr_t vector);
+uintptr_t NVIC_GetVector(IRQn_Type irq);
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+
+#define TIM_CR1_CEN 0x0001U
+#define TIM_CR1_DIR 0x0010U
+
+#define TIM_SMCR_SMS_0 0x0001U
+#define TIM_SMCR_SMS_1 0x0002U
+#define TIM_SMCR_SMS_2 0x0004U
+
+#define TIM_DIER_UIE 0x0001U
+#define TIM_DIER_CC1IE 0x0002U
+#define TIM_DIER_CC2IE 0x0004U
+#define TIM_DIER_CC3IE 0x0008U
+#define TIM_DIER_CC4IE 0x0010U
+
+#define TIM_SR_UIF 0x0001U
+#define TIM_SR_CC1IF 0x0002U
+#define TIM_SR_CC2IF 0x0004U
+#define TIM_SR_CC3IF 0x0008U
+#define TIM_SR_CC4IF 0x0010U
+#define TIM_SR_CC1OF 0x0200U
+#define TIM_SR_CC2OF 0x0400U
+
+#define TIM_EGR_UG 0x0001U
+
+#define TIM_CCMR1_CC1S_0 0x0001U
+#define TIM_CCMR1_IC1F_Pos 4U
+#define TIM_CCMR1_CC2S_0 0x0100U
+#define TIM_CCMR1_IC2F_Pos 12U
+
+#define TIM_CCER_CC1E 0x0001U
+#define TIM_CCER_CC1P 0x0002U
+#define TIM_CCER_CC1NP 0x0008U
+#define TIM_CCER_CC2E 0x0010U
+#define TIM_CCER_CC2P 0x0020U
+#define TIM_CCER_CC2NP 0x0080U
+
+#define __HAL_RCC_TIM1_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_TIM2_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_TIM3_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_TIM4_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_TIM5_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_TIM8_CLK_ENABLE() do {} while (0)
+
+#define RCC_HCLK_DIV1 0x0000U
+#define RCC_HCLK_DIV2 0x1000U
+
+typedef struct
+{
+    uint32_t APB1CLKDivider;
+} RCC_ClkInitTypeDef;
+
+void HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef *clkConfig, uint32_t *flashLatency);
+uint32_t HAL_RCC_GetPCLK1Freq();
+
+#endif
@@ -0,0 +1,116 @@
+#include "qei_test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static QEITestCase *firstCase = NULL;
+static QEITestCase *lastCase = NULL;
+static int failures = 0;
+
+//Forward state sequence, one channel changes per step.
+static const int forwardStates[4] = {0x0, 0x1, 0x3, 0x2};
+
+QEITestCase::QEITestCase(const char *name, QEITestFunction function)
+{
+    _name = name;
+    _function = function;
+    _next = NULL;
+
+    //Keep the registration order, which is the order within each file.
+    if (lastCase != NULL)
+        lastCase->_next = this;
+    else
+        firstCase = this;
+    lastCase = this;
+}
+
+int QEITestCase::runAll(const char *filter)
+{
+    int run = 0;
+    int failed = 0;
+
+    for (QEITestCase *test = firstCase; test != NULL; test = test->_next)
+    {
+        if (filter != NULL && strstr(test->_name, filter) == NULL)
+            continue;
+
+        int before = failures;
+        test->_function();
+        run++;
+        if (failures != before)
+        {
+            failed++;
+            printf("FAIL %s\n", test->_name);
+        }
+        else
+        {
+            printf("ok   %s\n", test->_name);
+        }
+    }
+
+    printf("%d tests, %d failed\n", run, failed);
+    return (failed == 0 && run > 0) ? 0 : 1;
+}
+
+void qei_test_fail(const char *file, int line, const char *expression, long long expected, long long actual)
+{
+    printf("%s:%d: %s, expected %lld, got %lld\n", file, line, expression, expected, actual);
+    failures++;
+}
+
+void qei_test_fail(const char *file, int line, const char *expression)
+{
+    printf("%s:%d: %s\n", file, line, expression);
+    failures++;
+}
+
+QEITestEncoder::QEITestEncoder(PinName channelA, PinName channelB)
+{
+    _channelA = channelA;
+    _channelB = channelB;
+    _nPhase = 0;
+    host_pin_write(channelA, 0);
+    host_pin_write(channelB, 0);
+}
+
+void QEITestEncoder::step(int direction)
+{
+    int previous = forwardStates[_nPhase];
+    _nPhase = (_nPhase + (direction > 0 ? 1 : 3)) & 3;
+    int state = forwardStates[_nPhase];
+
+    if ((previous ^ state) & 2)
+        host_pin_write(_channelA, (state >> 1) & 1);
+    else
+        host_pin_write(_channelB, state & 1);
+}
+
+void QEITestEncoder::skip()
+{
+    _nPhase = (_nPhase + 2) & 3;
+    int state = forwardStates[_nPhase];
+
+    //Channel A changes silently, the channel B interrupt sees both changed.
+    host_pin_set(_channelA, (state >> 1) & 1);
+    host_pin_write(_channelB, state & 1);
+}
+
+void QEITestEncoder::run(int nSteps, us_timestamp_t nInterval)
+{
+    int direction = (nSteps >= 0) ? 1 : -1;
+    for (int i = 0; i < nSteps * direction; i++)
+    {
+        host_advance_us(nInterval);
+        step(direction);
+    }
+}
+
+int QEITestEncoder::getState()
+{
+    return forwardStates[_nPhase];
+}
+
+int main(int argc, char **argv)
+{
+    return QEITestCase::runAll((argc > 1) ? argv[1] : NULL);
+}
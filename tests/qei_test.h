@@ -0,0 +1,109 @@
+/**
+ * Minimal test harness for the host build.
+ *
+ * QEI_TEST(name) defines a test case which registers itself, the checks
+ * report the failing expression and keep going. QEITestEncoder drives the
+ * channel pins of the host stand-in one quadrature edge at a time.
+ */
+
+#ifndef _QEI_TEST_H_
+#define _QEI_TEST_H_
+
+#include "mbed.h"
+
+typedef void (*QEITestFunction)();
+
+/**
+ * A registered test case.
+ */
+class QEITestCase
+{
+
+public:
+    QEITestCase(const char *name, QEITestFunction function);
+
+    static int runAll(const char *filter);
+
+private:
+    const char *_name;
+    QEITestFunction _function;
+    QEITestCase *_next;
+};
+
+void qei_test_fail(const char *file, int line, const char *expression, long long expected, long long actual);
+void qei_test_fail(const char *file, int line, const char *expression);
+
+#define QEI_TEST(name)                                   \
+    static void name();                                  \
+    static QEITestCase name##Case(#name, name);          \
+    static void name()
+
+#define QEI_CHECK(expression)                                     \
+    do                                                            \
+    {                                                             \
+        if (!(expression))                                        \
+            qei_test_fail(__FILE__, __LINE__, #expression);       \
+    } while (0)
+
+#define QEI_CHECK_EQUAL(expected, actual)                                                              \
+    do                                                                                                 \
+    {                                                                                                  \
+        long long _expected = (long long)(expected);                                                   \
+        long long _actual = (long long)(actual);                                                       \
+        if (_expected != _actual)                                                                      \
+            qei_test_fail(__FILE__, __LINE__, #expected " == " #actual, _expected, _actual);           \
+    } while (0)
+
+#define QEI_CHECK_CLOSE(expected, actual, tolerance)                                                   \
+    do                                                                                                 \
+    {                                                                                                  \
+        double _difference = (double)(expected) - (double)(actual);                                    \
+        if (_difference > (tolerance) || _difference < -(tolerance))                                   \
+            qei_test_fail(__FILE__, __LINE__, #expected " ~ " #actual);                                \
+    } while (0)
+
+/**
+ * Drives channel A and B of an encoder on the host pins.
+ * Counting forward is channel B leading: states 00, 01, 11, 10 as (A << 1) | B.
+ */
+class QEITestEncoder
+{
+
+public:
+    /**
+     * Contructor
+     * Sets both channels low, construct it before the encoder under test.
+     */
+    QEITestEncoder(PinName channelA, PinName channelB);
+
+    /**
+     * Change one channel, one quadrature edge forward or backward.
+     * @param direction +1 or -1
+     */
+    void step(int direction);
+
+    /**
+     * Change both channels at once, two edges in a single interrupt: edges
+     * lost by the decoder. Forward and backward are the same state.
+     */
+    void skip();
+
+    /**
+     * Advance the time by nInterval before each of |nSteps| edges.
+     * @param nSteps Edges to make, negative for backward.
+     * @param nInterval Microseconds before each edge.
+     */
+    void run(int nSteps, us_timestamp_t nInterval);
+
+    /**
+     * @return Current 2-bit state, (A << 1) | B.
+     */
+    int getState();
+
+private:
+    PinName _channelA;
+    PinName _channelB;
+    int _nPhase; //Position in the forward state sequence
+};
+
+#endif
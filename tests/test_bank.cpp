@@ -0,0 +1,76 @@
+#include "qei_test.h"
+#include "QEIBank.h"
+
+//Drives encoder i of a port layout to a 2-bit state.
+static uint32_t portOf(const uint8_t *bitsA, const uint8_t *bitsB, const int *states, unsigned int n)
+{
+    uint32_t port = 0;
+    for (unsigned int i = 0; i < n; i++)
+        port |= ((uint32_t)(states[i] >> 1) << bitsA[i]) | ((uint32_t)(states[i] & 1) << bitsB[i]);
+    return port;
+}
+
+template <unsigned int N>
+class TestBank : public QEIBank<N>
+{
+
+public:
+    TestBank(PortName port, const uint8_t bitsA[N], const uint8_t bitsB[N]) : QEIBank<N>(port, bitsA, bitsB) {}
+
+    using QEIBank<N>::_bPacked;
+    using QEIBank<N>::_bSwapped;
+};
+
+//Encoder i turns forward for 40 + 10 * i edges, every encoder moving on the same port write.
+template <unsigned int N>
+static void runBank(TestBank<N> &bank, PortName port, const uint8_t *bitsA, const uint8_t *bitsB)
+{
+    static const int forward[4] = {0x0, 0x1, 0x3, 0x2};
+    int states[N];
+
+    for (int step = 1; step <= 40 + 10 * (int)N; step++)
+    {
+        for (unsigned int i = 0; i < N; i++)
+            states[i] = forward[((step < 40 + 10 * (int)i) ? step : 40 + 10 * (int)i) & 3];
+        host_port_write(port, portOf(bitsA, bitsB, states, N));
+    }
+
+    for (unsigned int i = 0; i < N; i++)
+        QEI_CHECK_EQUAL(40 + 10 * (int)i, bank[i].read());
+}
+
+QEI_TEST(bankPacksChannelAOnOddBits)
+{
+    const uint8_t bitsA[6] = {1, 3, 5, 7, 9, 11};
+    const uint8_t bitsB[6] = {0, 2, 4, 6, 8, 10};
+    host_port_write(PortB, 0);
+    TestBank<6> bank(PortB, bitsA, bitsB);
+
+    QEI_CHECK(bank._bPacked);
+    QEI_CHECK(!bank._bSwapped);
+    runBank(bank, PortB, bitsA, bitsB);
+}
+
+QEI_TEST(bankPacksChannelAOnEvenBits)
+{
+    //The layout of the header example.
+    const uint8_t bitsA[6] = {0, 2, 4, 6, 8, 10};
+    const uint8_t bitsB[6] = {1, 3, 5, 7, 9, 11};
+    host_port_write(PortB, 0);
+    TestBank<6> bank(PortB, bitsA, bitsB);
+
+    QEI_CHECK(bank._bPacked);
+    QEI_CHECK(bank._bSwapped);
+    runBank(bank, PortB, bitsA, bitsB);
+}
+
+QEI_TEST(bankMixedLayoutUsesTables)
+{
+    const uint8_t bitsA[3] = {1, 2, 20};
+    const uint8_t bitsB[3] = {0, 3, 7};
+    host_port_write(PortC, 0);
+    TestBank<3> bank(PortC, bitsA, bitsB);
+
+    QEI_CHECK(!bank._bPacked);
+    runBank(bank, PortC, bitsA, bitsB);
+}
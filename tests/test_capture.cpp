@@ -0,0 +1,122 @@
+#include "qei_test.h"
+#include "QEICapture.h"
+#include "PeripheralPins.h"
+
+//Forward is channel B leading: capture channel 2 from states 00 and 11, channel 1 from 01 and 10.
+static void captureSteps(TIM_TypeDef *tim, int nSteps, uint64_t nInterval, int &phase)
+{
+    for (int i = 0; i < nSteps; i++)
+    {
+        host_tim_tick(tim, nInterval);
+        host_tim_capture(tim, (phase & 1) ? 1 : 2);
+        phase = (phase + 1) & 3;
+    }
+}
+
+//Moves the pins one edge at a time, capturing only the channel A edges like X2.
+static void captureStepsX2(QEITestEncoder &pins, int nSteps, uint64_t nInterval)
+{
+    int direction = (nSteps < 0) ? -1 : 1;
+    for (int i = 0; i != nSteps; i += direction)
+    {
+        int before = pins.getState();
+        host_tim_tick(TIM2, nInterval);
+        pins.step(direction);
+        if ((pins.getState() ^ before) & 2)
+            host_tim_capture(TIM2, 1);
+    }
+}
+
+QEI_TEST(captureCountsEdges)
+{
+    host_tim_reset();
+    host_pin_set(PA_0, 0);
+    host_pin_set(PA_1, 0);
+    QEICapture encoder(PA_0, PA_1, NC);
+    int phase = 0;
+
+    captureSteps(TIM2, 1001, 10, phase);
+    QEI_CHECK_EQUAL(1001, encoder.read());
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().invalidTransitions);
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().lostCaptures);
+    QEI_CHECK_EQUAL(10, encoder.getDiagnostics().minEdgeInterval);
+}
+
+QEI_TEST(captureKeepsEdgeRacingTheStatusRead)
+{
+    host_tim_reset();
+    host_pin_set(PA_0, 0);
+    host_pin_set(PA_1, 0);
+    QEICapture encoder(PA_0, PA_1, NC);
+
+    //Channel A captures right after the interrupt of the channel B edge read SR.
+    int reads = 0;
+    TIM2->SR.onRead = [&reads]()
+    {
+        if (reads++ == 0)
+        {
+            TIM2->CNT.value += 5;
+            host_tim_capture(TIM2, 1, false);
+        }
+    };
+    host_tim_tick(TIM2, 10);
+    host_tim_capture(TIM2, 2);
+    TIM2->SR.onRead = nullptr;
+
+    //The channel A flag survived, its interrupt is still pending.
+    QEI_CHECK_EQUAL(1, encoder.read());
+    QEI_CHECK(TIM2->SR.value & TIM_SR_CC1IF);
+    host_tim_interrupt(TIM2);
+    QEI_CHECK_EQUAL(2, encoder.read());
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().invalidTransitions);
+    QEI_CHECK_EQUAL(5, encoder.getDiagnostics().minEdgeInterval);
+}
+
+QEI_TEST(captureCountsOvercaptures)
+{
+    host_tim_reset();
+    host_pin_set(PA_0, 0);
+    host_pin_set(PA_1, 0);
+    QEICapture encoder(PA_0, PA_1, NC);
+
+    //00 -> 01 -> 11 -> 10 with the interrupt held off, the second B capture overwrites the first.
+    TIM2->CNT.value += 10;
+    host_tim_capture(TIM2, 2, false);
+    TIM2->CNT.value += 10;
+    host_tim_capture(TIM2, 1, false);
+    TIM2->CNT.value += 10;
+    host_pin_set(PA_0, 1);
+    host_tim_capture(TIM2, 2, false);
+    host_tim_interrupt(TIM2);
+
+    QEI_CHECK_EQUAL(1, encoder.getDiagnostics().lostCaptures);
+    QEI_CHECK_EQUAL(0, TIM2->SR.value & (TIM_SR_CC1OF | TIM_SR_CC2OF));
+
+    //The state follows the pins again, the next edges decode cleanly.
+    int before = encoder.read();
+    int phase = 3;
+    captureSteps(TIM2, 8, 10, phase);
+    QEI_CHECK_EQUAL(before + 8, encoder.read());
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().invalidTransitions);
+
+    encoder.resetDiagnostics();
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().lostCaptures);
+}
+
+QEI_TEST(captureX2ReadsChannelB)
+{
+    host_tim_reset();
+    QEITestEncoder pins(PA_0, PA_1);
+    QEICapture encoder(PA_0, PA_1, NC, QEI::X2_ENCODING);
+    QEI live(PA_0, PA_1, NC, QEI::X2_ENCODING);
+
+    //Same count as the channel A interrupts, in both directions.
+    captureStepsX2(pins, 40, 10);
+    QEI_CHECK(encoder.read() > 0);
+    QEI_CHECK_EQUAL(live.read(), encoder.read());
+
+    captureStepsX2(pins, -100, 10);
+    QEI_CHECK(encoder.read() < 0);
+    QEI_CHECK_EQUAL(live.read(), encoder.read());
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().invalidTransitions);
+}
@@ -0,0 +1,337 @@
+#include "qei_test.h"
+#include "QEI.h"
+#include "QEICompare.h"
+
+//Table indices fired so far, in order.
+static unsigned int compareFired[64];
+static int compareFiredCount;
+
+static void compareFire(unsigned int index)
+{
+    if (compareFiredCount < 64)
+        compareFired[compareFiredCount] = index;
+    compareFiredCount++;
+}
+
+static const QEICompareTarget tableTargets[] = {{100, 0x1}, {200, 0x2}, {300, 0x4}};
+static const QEICompareTarget repeatingTargets[] = {{250, 0x1}, {700, 0x2}};
+
+QEI_TEST(compareTableFiresInOrder)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompare compare;
+    EventFlags flags;
+
+    compare.setTargets(tableTargets, 3);
+    compare.setCallback(callback(compareFire));
+    compare.setEventFlags(&flags);
+    compareFiredCount = 0;
+    encoder.setCompare(&compare);
+    QEI_CHECK_EQUAL(3, compare.getPending());
+
+    //Each target on the edge reaching it, with its flags.
+    pins.run(199, 1);
+    QEI_CHECK_EQUAL(1, compareFiredCount);
+    QEI_CHECK_EQUAL(0x1, flags.get());
+    pins.run(1, 1);
+    QEI_CHECK_EQUAL(2, compareFiredCount);
+    QEI_CHECK_EQUAL(0x3, flags.get());
+    pins.run(150, 1);
+    QEI_CHECK_EQUAL(3, compareFiredCount);
+    QEI_CHECK_EQUAL(0x7, flags.get());
+    for (int i = 0; i < 3; i++)
+        QEI_CHECK_EQUAL(i, compareFired[i]);
+
+    //One-shot: used up, nothing fires on the way back.
+    QEI_CHECK_EQUAL(0, compare.getPending());
+    pins.run(-350, 1);
+    QEI_CHECK_EQUAL(3, compareFiredCount);
+
+    encoder.setCompare(NULL);
+}
+
+QEI_TEST(compareTableCrossedBackwards)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompare compare;
+    EventFlags flags;
+
+    compare.setTargets(tableTargets, 3);
+    compare.setCallback(callback(compareFire));
+    compare.setEventFlags(&flags);
+    compareFiredCount = 0;
+
+    //Attached at 250, the targets below fire moving down, the one above moving up.
+    encoder.write64(250);
+    encoder.setCompare(&compare);
+    pins.run(-200, 1);
+    QEI_CHECK_EQUAL(2, compareFiredCount);
+    QEI_CHECK_EQUAL(1, compareFired[0]);
+    QEI_CHECK_EQUAL(0, compareFired[1]);
+    QEI_CHECK_EQUAL(0x3, flags.get());
+    pins.run(300, 1);
+    QEI_CHECK_EQUAL(3, compareFiredCount);
+    QEI_CHECK_EQUAL(2, compareFired[2]);
+
+    encoder.setCompare(NULL);
+}
+
+QEI_TEST(compareTableRearmsAfterWrite)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompare compare;
+
+    compare.setTargets(tableTargets, 3);
+    compare.setCallback(callback(compareFire));
+    compareFiredCount = 0;
+    encoder.setCompare(&compare);
+
+    //write() jumps over 100 and 200 without firing them.
+    encoder.write(250);
+    QEI_CHECK_EQUAL(0, compareFiredCount);
+    QEI_CHECK_EQUAL(1, compare.getPending());
+    pins.run(100, 1);
+    QEI_CHECK_EQUAL(1, compareFiredCount);
+    QEI_CHECK_EQUAL(2, compareFired[0]);
+
+    //Attaching again after write64() re-arms the whole table.
+    encoder.write64(0);
+    encoder.setCompare(&compare);
+    QEI_CHECK_EQUAL(3, compare.getPending());
+    pins.run(300, 1);
+    QEI_CHECK_EQUAL(4, compareFiredCount);
+
+    encoder.setCompare(NULL);
+}
+
+QEI_TEST(compareSequenceFiresInOrder)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompareSequence compare(50, 100, 0x8);
+    EventFlags flags;
+
+    compare.setCallback(callback(compareFire));
+    compare.setEventFlags(&flags);
+    compareFiredCount = 0;
+    encoder.setCompare(&compare);
+
+    //50, 150, 250 up, the same back down, then -50 as target -1.
+    pins.run(260, 1);
+    QEI_CHECK_EQUAL(3, compareFiredCount);
+    QEI_CHECK_EQUAL(0x8, flags.get());
+    for (int i = 0; i < 3; i++)
+        QEI_CHECK_EQUAL(i, compareFired[i]);
+
+    pins.run(-320, 1);
+    QEI_CHECK_EQUAL(7, compareFiredCount);
+    QEI_CHECK_EQUAL(2, compareFired[3]);
+    QEI_CHECK_EQUAL(0, compareFired[5]);
+    QEI_CHECK_EQUAL((unsigned int)-1, compareFired[6]);
+
+    encoder.setCompare(NULL);
+}
+
+QEI_TEST(compareSequenceFollowsWrite)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompareSequence compare(50, 100);
+
+    compare.setCallback(callback(compareFire));
+    compareFiredCount = 0;
+    encoder.setCompare(&compare);
+
+    //The jumps fire nothing, the targets next to the new count are armed.
+    encoder.write64(1000);
+    encoder.write(-1);
+    QEI_CHECK_EQUAL(0, compareFiredCount);
+    pins.run(51, 1);
+    QEI_CHECK_EQUAL(1, compareFiredCount);
+    QEI_CHECK_EQUAL(0, compareFired[0]);
+
+    encoder.write64(1000);
+    pins.run(-50, 1);
+    QEI_CHECK_EQUAL(2, compareFiredCount);
+    QEI_CHECK_EQUAL(9, compareFired[1]);
+
+    encoder.setCompare(NULL);
+}
+
+QEI_TEST(compareRepeatingFiresEveryPeriod)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompareRepeating compare(1000);
+    EventFlags flags;
+
+    compare.setTargets(repeatingTargets, 2);
+    compare.setCallback(callback(compareFire));
+    compare.setEventFlags(&flags);
+    compareFiredCount = 0;
+    encoder.setCompare(&compare);
+
+    //250, 700, 1250, 1700, 2250, 2700
+    pins.run(3000, 1);
+    QEI_CHECK_EQUAL(6, compareFiredCount);
+    for (int i = 0; i < 6; i++)
+        QEI_CHECK_EQUAL(i & 1, compareFired[i]);
+    QEI_CHECK_EQUAL(0x3, flags.get());
+    QEI_CHECK_EQUAL(2, compare.getPending());
+
+    //Back down from 3000, 2700 re-armed once the count passed it, down to 700 - 1000.
+    pins.run(-3300, 1);
+    QEI_CHECK_EQUAL(13, compareFiredCount);
+    QEI_CHECK_EQUAL(1, compareFired[6]);
+    QEI_CHECK_EQUAL(0, compareFired[11]);
+    QEI_CHECK_EQUAL(1, compareFired[12]);
+    QEI_CHECK_EQUAL(-300, encoder.read());
+
+    encoder.setCompare(NULL);
+}
+
+QEI_TEST(compareRepeatingJitterFiresOnce)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompareRepeating compare(1000);
+
+    compare.setTargets(repeatingTargets, 2);
+    compare.setCallback(callback(compareFire));
+    compareFiredCount = 0;
+    encoder.setCompare(&compare);
+
+    pins.run(250, 1);
+    QEI_CHECK_EQUAL(1, compareFiredCount);
+    for (int i = 0; i < 10; i++)
+    {
+        pins.run(-1, 1);
+        pins.run(1, 1);
+    }
+    QEI_CHECK_EQUAL(1, compareFiredCount);
+
+    //It fires again once the count reached the next target, from either side.
+    pins.run(450, 1);
+    QEI_CHECK_EQUAL(2, compareFiredCount);
+    pins.run(-450, 1);
+    QEI_CHECK_EQUAL(3, compareFiredCount);
+    QEI_CHECK_EQUAL(0, compareFired[2]);
+
+    encoder.setCompare(NULL);
+}
+
+QEI_TEST(compareRepeatingHysteresis)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompareRepeating compare(1000);
+
+    compare.setTargets(repeatingTargets, 2);
+    compare.setCallback(callback(compareFire));
+    compare.setHysteresis(5);
+    compareFiredCount = 0;
+    encoder.setCompare(&compare);
+
+    //Less than the hysteresis past the target and back does not fire it again.
+    pins.run(254, 1);
+    pins.run(-4, 1);
+    QEI_CHECK_EQUAL(1, compareFiredCount);
+
+    //Five counts past it re-arms it, coming back fires it.
+    pins.run(5, 1);
+    pins.run(-5, 1);
+    QEI_CHECK_EQUAL(2, compareFiredCount);
+    pins.run(-5, 1);
+    pins.run(5, 1);
+    QEI_CHECK_EQUAL(3, compareFiredCount);
+    QEI_CHECK_EQUAL(0, compareFired[2]);
+
+    encoder.setCompare(NULL);
+}
+
+QEI_TEST(compareSequenceRefiresAfterReversal)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompareSequence compare(0, 100);
+
+    compare.setCallback(callback(compareFire));
+    compareFiredCount = 0;
+    encoder.setCompare(&compare);
+
+    //100, 200, 300, then back through 300 after going 30 past it.
+    pins.run(330, 1);
+    QEI_CHECK_EQUAL(3, compareFiredCount);
+    pins.run(-30, 1);
+    QEI_CHECK_EQUAL(4, compareFiredCount);
+    QEI_CHECK_EQUAL(3, compareFired[3]);
+
+    //Jitter on the approach side fires once.
+    for (int i = 0; i < 10; i++)
+    {
+        pins.run(1, 1);
+        pins.run(-1, 1);
+    }
+    QEI_CHECK_EQUAL(4, compareFiredCount);
+
+    pins.run(-300, 1);
+    QEI_CHECK_EQUAL(7, compareFiredCount);
+    QEI_CHECK_EQUAL(0, compareFired[6]);
+
+    encoder.setCompare(NULL);
+}
+
+QEI_TEST(compareRepeatingFollowsJumps)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompareRepeating compare(1000);
+
+    compare.setTargets(repeatingTargets, 2);
+    compare.setCallback(callback(compareFire));
+    compareFiredCount = 0;
+    encoder.setCompare(&compare);
+
+    //The jump drops the targets on the way, the ones around the new count are armed.
+    encoder.write64(-5000000000LL + 699);
+    QEI_CHECK_EQUAL(0, compareFiredCount);
+    pins.run(1, 1);
+    QEI_CHECK_EQUAL(1, compareFiredCount);
+    QEI_CHECK_EQUAL(1, compareFired[0]);
+    pins.run(-450, 1);
+    QEI_CHECK_EQUAL(2, compareFiredCount);
+    QEI_CHECK_EQUAL(0, compareFired[1]);
+
+    //Attached on a target: that one is not fired, the next ones are.
+    encoder.write64(1250);
+    encoder.setCompare(&compare);
+    pins.run(-550, 1);
+    QEI_CHECK_EQUAL(3, compareFiredCount);
+    QEI_CHECK_EQUAL(1, compareFired[2]);
+
+    encoder.setCompare(NULL);
+}
+
+QEI_TEST(compareRepeatingTogglesOutput)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEICompareRepeating compare(100);
+    static const QEICompareTarget targets[] = {{10, 0}};
+
+    compare.setTargets(targets, 1);
+    compare.setOutput(4);
+    encoder.setCompare(&compare);
+
+    pins.run(10, 1);
+    QEI_CHECK_EQUAL(1, host_pin_read(4));
+    pins.run(100, 1);
+    QEI_CHECK_EQUAL(0, host_pin_read(4));
+    pins.run(-100, 1);
+    QEI_CHECK_EQUAL(1, host_pin_read(4));
+
+    encoder.setCompare(NULL);
+}
@@ -0,0 +1,71 @@
+#include "qei_test.h"
+#include "QEI.h"
+
+QEI_TEST(count64CrossesZero)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+
+    //The low word wraps to 0xFFFFFFFF and back, the high word follows.
+    encoder.write64(3);
+    pins.run(-10, 10);
+    QEI_CHECK_EQUAL(-7, encoder.read64());
+    QEI_CHECK_EQUAL(-7, encoder.read());
+    pins.run(10, 10);
+    QEI_CHECK_EQUAL(3, encoder.read64());
+    QEI_CHECK_EQUAL(3, encoder.read());
+
+    encoder.write(-1);
+    QEI_CHECK_EQUAL(-1, encoder.read64());
+    pins.run(1, 10);
+    QEI_CHECK_EQUAL(0, encoder.read64());
+    pins.run(-1, 10);
+    QEI_CHECK_EQUAL(-1, encoder.read64());
+}
+
+QEI_TEST(count64CarriesPastInt32)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    const int64_t max32 = INT32_MAX;
+
+    //read() wraps like the 32-bit count always did, read64() keeps going.
+    encoder.write64(max32 - 5);
+    pins.run(10, 10);
+    QEI_CHECK_EQUAL(max32 + 5, encoder.read64());
+    QEI_CHECK_EQUAL(INT32_MIN + 4, encoder.read());
+    pins.run(-10, 10);
+    QEI_CHECK_EQUAL(max32 - 5, encoder.read64());
+
+    encoder.write64(-max32 - 1 + 5);
+    pins.run(-10, 10);
+    QEI_CHECK_EQUAL(-max32 - 1 - 5, encoder.read64());
+    QEI_CHECK_EQUAL(INT32_MAX - 4, encoder.read());
+    pins.run(10, 10);
+    QEI_CHECK_EQUAL(-max32 - 1 + 5, encoder.read64());
+}
+
+QEI_TEST(count64CarriesIntoHighWord)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    const int64_t word = (int64_t)1 << 32;
+
+    encoder.write64(word - 5);
+    pins.run(10, 10);
+    QEI_CHECK_EQUAL(word + 5, encoder.read64());
+    pins.run(-10, 10);
+    QEI_CHECK_EQUAL(word - 5, encoder.read64());
+
+    encoder.write64(-word + 5);
+    pins.run(-10, 10);
+    QEI_CHECK_EQUAL(-word - 5, encoder.read64());
+    pins.run(10, 10);
+    QEI_CHECK_EQUAL(-word + 5, encoder.read64());
+
+    //Several words away, written and read back unchanged.
+    encoder.write64(-3 * word - 1);
+    QEI_CHECK_EQUAL(-3 * word - 1, encoder.read64());
+    pins.run(1, 10);
+    QEI_CHECK_EQUAL(-3 * word, encoder.read64());
+}
@@ -0,0 +1,115 @@
+#include "qei_test.h"
+#include "QEI.h"
+
+QEI_TEST(decoderX4CountsEveryEdge)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+
+    pins.run(100, 10);
+    QEI_CHECK_EQUAL(100, encoder.read());
+
+    pins.run(-40, 10);
+    QEI_CHECK_EQUAL(60, encoder.read());
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().invalidTransitions);
+}
+
+QEI_TEST(decoderX2FollowsDocumentedPatterns)
+{
+    //11->00 and 00->10 count forward, 10->01 and 01->10 count backward.
+    static const int forward[3] = {0x3, 0x0, 0x2};
+    static const int backward[3] = {0x2, 0x1, 0x2};
+
+    QEIDecoder decoder(forward[0]);
+    QEI_CHECK_EQUAL(1, decoder.step<QEIDecoder::X2_ENCODING>(forward[1]).delta);
+    QEI_CHECK_EQUAL(1, decoder.step<QEIDecoder::X2_ENCODING>(forward[2]).delta);
+
+    decoder = QEIDecoder(backward[0]);
+    QEI_CHECK_EQUAL(-1, decoder.step<QEIDecoder::X2_ENCODING>(backward[1]).delta);
+    QEI_CHECK_EQUAL(-1, decoder.step<QEIDecoder::X2_ENCODING>(backward[2]).delta);
+}
+
+QEI_TEST(decoderX2OnlyInterruptsOnChannelA)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X2_ENCODING);
+
+    //Channel B alone never runs the decoder.
+    host_advance_us(10);
+    host_pin_write(1, 1);
+    host_advance_us(10);
+    host_pin_write(1, 0);
+    QEI_CHECK_EQUAL(0, encoder.read());
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().invalidTransitions);
+}
+
+QEI_TEST(decoderTemplateMatchesRuntime)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    QEIT<QEI::X4_ENCODING> encoderX4(0, 1, NC);
+
+    pins.run(37, 10);
+    pins.run(-5, 10);
+    QEI_CHECK_EQUAL(32, encoderX4.read());
+    QEI_CHECK_EQUAL(encoder.read(), encoderX4.read());
+}
+
+QEI_TEST(decoderCountsInvalidTransitions)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+
+    //Both channels change before the interrupt runs: a lost edge, not a count.
+    host_port_write(PortA, 0x3);
+    QEI_CHECK_EQUAL(0, encoder.read());
+    QEI_CHECK_EQUAL(1, encoder.getDiagnostics().invalidTransitions);
+}
+
+QEI_TEST(decoderTableMatchesStateSequence)
+{
+    static const int forward[4] = {0x0, 0x1, 0x3, 0x2};
+
+    for (int i = 0; i < 4; i++)
+    {
+        QEIDecoder decoder(forward[i]);
+        QEI_CHECK_EQUAL(1, decoder.step<QEIDecoder::X4_ENCODING>(forward[(i + 1) & 3]).delta);
+
+        decoder = QEIDecoder(forward[i]);
+        QEI_CHECK_EQUAL(-1, decoder.step<QEIDecoder::X4_ENCODING>(forward[(i + 3) & 3]).delta);
+
+        decoder = QEIDecoder(forward[i]);
+        QEI_CHECK_EQUAL(1, decoder.step<QEIDecoder::X4_ENCODING>(forward[(i + 2) & 3]).invalid);
+    }
+}
+
+QEI_TEST(decoderDiagnosticsReset)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+
+    pins.run(20, 25);
+    pins.run(20, 10);
+    host_advance_us(50);
+    pins.skip();
+    pins.run(20, 40);
+
+    QEIDiagnostics diagnostics = encoder.getDiagnostics();
+    QEI_CHECK_EQUAL(1, diagnostics.invalidTransitions);
+    QEI_CHECK_EQUAL(10, diagnostics.minEdgeInterval);
+    QEI_CHECK_EQUAL(100000, diagnostics.maxEdgeRate);
+    QEI_CHECK_EQUAL(0, diagnostics.rejectedEdges);
+
+    //Counters back to zero, the shortest interval back to unset until the next edges.
+    encoder.resetDiagnostics();
+    diagnostics = encoder.getDiagnostics();
+    QEI_CHECK_EQUAL(0, diagnostics.invalidTransitions);
+    QEI_CHECK_EQUAL(0xFFFFFFFF, diagnostics.minEdgeInterval);
+    QEI_CHECK_EQUAL(0, diagnostics.maxEdgeRate);
+
+    pins.run(5, 40);
+    diagnostics = encoder.getDiagnostics();
+    QEI_CHECK_EQUAL(0, diagnostics.invalidTransitions);
+    QEI_CHECK_EQUAL(40, diagnostics.minEdgeInterval);
+    QEI_CHECK_EQUAL(25000, diagnostics.maxEdgeRate);
+}
@@ -0,0 +1,57 @@
+#include "qei_test.h"
+#include "QEIEdgeLog.h"
+
+#include <thread>
+
+QEI_TEST(edgeLogDropsWhenFull)
+{
+    QEIEdgeLog<4> edgeLog;
+    QEIEdgeRecord records[8];
+
+    for (int i = 0; i < 6; i++)
+        edgeLog.push(i, i & 3, 1, 0);
+    QEI_CHECK_EQUAL(4, edgeLog.size());
+    QEI_CHECK_EQUAL(2, edgeLog.getOverflows());
+
+    QEI_CHECK_EQUAL(4, edgeLog.pop(records, 8));
+    QEI_CHECK_EQUAL(0, records[0].time);
+    QEI_CHECK_EQUAL(3, records[3].time);
+    QEI_CHECK_EQUAL(0, edgeLog.size());
+}
+
+QEI_TEST(edgeLogRecordsCompleteAcrossThreads)
+{
+    static QEIEdgeLog<64> edgeLog;
+    const uint32_t total = 200000;
+
+    //Every record popped must be fully written: the fields all derive from the time.
+    std::thread producer([&]() {
+        for (uint32_t time = 0; time < total;)
+        {
+            if (edgeLog.push(time, time & 3, (time & 4) ? 1 : -1, time & 1))
+                time++;
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    uint32_t expected = 0;
+    unsigned int broken = 0;
+    QEIEdgeRecord records[16];
+    while (expected < total)
+    {
+        unsigned int count = edgeLog.pop(records, 16);
+        if (count == 0)
+            std::this_thread::yield();
+        for (unsigned int i = 0; i < count; i++, expected++)
+        {
+            const QEIEdgeRecord &record = records[i];
+            if (record.time != expected || record.state != (expected & 3) || record.delta != ((expected & 4) ? 1 : -1) || record.invalid != (expected & 1))
+                broken++;
+        }
+    }
+    producer.join();
+
+    QEI_CHECK_EQUAL(0, broken);
+    QEI_CHECK_EQUAL(total, expected);
+}
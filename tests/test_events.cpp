@@ -0,0 +1,116 @@
+#include "qei_test.h"
+#include "QEI.h"
+#include "QEIEvents.h"
+
+//Handler calls so far and the events of the last one.
+static int eventsCalls;
+static uint32_t eventsLast;
+
+static void eventsHandler(uint32_t events)
+{
+    eventsCalls++;
+    eventsLast = events;
+}
+
+//Runs the queue every nStep us for nTime us.
+static void eventsRun(EventQueue &queue, us_timestamp_t nTime, us_timestamp_t nStep)
+{
+    for (us_timestamp_t time = 0; time < nTime; time += nStep)
+    {
+        host_advance_us(nStep);
+        queue.dispatch(0);
+    }
+}
+
+QEI_TEST(eventsCoalesceDirectionBurst)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    EventQueue queue;
+    EventFlags flags;
+    QEIEvents events(&queue, &flags);
+
+    events.setHandler(callback(eventsHandler));
+    encoder.setEvents(&events);
+    eventsCalls = 0;
+
+    //Twenty reversals before the queue runs: one dispatch with one DIRECTION event.
+    pins.run(1, 10);
+    for (int i = 0; i < 10; i++)
+    {
+        pins.run(-1, 10);
+        pins.run(1, 10);
+    }
+    QEI_CHECK_EQUAL(0, eventsCalls);
+    QEI_CHECK_EQUAL(QEIEvents::DIRECTION_EVENT, flags.get());
+
+    queue.dispatch(0);
+    QEI_CHECK_EQUAL(1, eventsCalls);
+    QEI_CHECK_EQUAL(QEIEvents::DIRECTION_EVENT, eventsLast);
+    QEI_CHECK_EQUAL(1, events.getDirection());
+    QEI_CHECK_EQUAL(0, events.getDropped());
+
+    //Nothing pending, nothing delivered.
+    queue.dispatch(0);
+    QEI_CHECK_EQUAL(1, eventsCalls);
+
+    encoder.setEvents(NULL);
+}
+
+QEI_TEST(eventsStallAfterTimeout)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    EventQueue queue;
+    QEIEvents events(&queue);
+
+    events.setHandler(callback(eventsHandler));
+    events.setStallTimeout(100);
+    encoder.setEvents(&events);
+    eventsCalls = 0;
+
+    //Moving, then stopped for less than the timeout.
+    for (int i = 0; i < 10; i++)
+    {
+        pins.run(10, 1000);
+        queue.dispatch(0);
+    }
+    eventsRun(queue, 60000, 5000);
+    QEI_CHECK_EQUAL(0, eventsCalls);
+
+    //The timeout without edges posts one STALL, a longer stop no more.
+    eventsRun(queue, 100000, 5000);
+    QEI_CHECK_EQUAL(1, eventsCalls);
+    QEI_CHECK_EQUAL(QEIEvents::STALL_EVENT, eventsLast);
+    eventsRun(queue, 500000, 5000);
+    QEI_CHECK_EQUAL(1, eventsCalls);
+
+    //Moving again and stopping stalls again.
+    pins.run(10, 1000);
+    eventsRun(queue, 200000, 5000);
+    QEI_CHECK_EQUAL(2, eventsCalls);
+    QEI_CHECK_EQUAL(QEIEvents::STALL_EVENT, eventsLast);
+
+    encoder.setEvents(NULL);
+}
+
+QEI_TEST(eventsNoneWhenDetached)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    EventQueue queue;
+    EventFlags flags;
+    QEIEvents events(&queue, &flags);
+
+    events.setHandler(callback(eventsHandler));
+    encoder.setEvents(&events);
+    encoder.setEvents(NULL);
+    eventsCalls = 0;
+
+    pins.run(10, 10);
+    pins.run(-10, 10);
+    queue.dispatch(0);
+    QEI_CHECK_EQUAL(0, eventsCalls);
+    QEI_CHECK_EQUAL(0, flags.get());
+    QEI_CHECK_EQUAL(0, events.getDirection());
+}
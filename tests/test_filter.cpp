@@ -0,0 +1,64 @@
+#include "qei_test.h"
+#include "QEI.h"
+#include "QEICompare.h"
+#include "QEIEdgeLog.h"
+
+QEI_TEST(filterGlitchHasNoSideEffects)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    static const QEICompareTarget targets[] = {{1, 0x1}};
+    QEICompare compare;
+    EventFlags flags;
+    QEIEdgeLog<16> edgeLog;
+    compare.setTargets(targets, 1);
+    compare.setEventFlags(&flags);
+    encoder.setCompare(&compare);
+    encoder.setEdgeLog(&edgeLog);
+    encoder.setGlitchFilter(1, 50);
+
+    //A 10 us spike forward and back.
+    pins.run(1, 100);
+    pins.run(-1, 10);
+    host_advance_us(100);
+
+    QEI_CHECK_EQUAL(0, encoder.read());
+    QEI_CHECK_EQUAL(0, flags.get());
+    QEI_CHECK_EQUAL(0, edgeLog.size());
+    QEI_CHECK_EQUAL(1, encoder.getRejectedEdges());
+}
+
+class FilterQEI : public QEI
+{
+
+public:
+    FilterQEI() : QEI(0, 1, NC, X4_ENCODING) {}
+
+    using QEI::now;
+};
+
+QEI_TEST(filterCountsWidePulseAfterWidth)
+{
+    QEITestEncoder pins(0, 1);
+    FilterQEI encoder;
+    QEIEdgeLog<16> edgeLog;
+    encoder.setEdgeLog(&edgeLog);
+    encoder.setGlitchFilter(1, 50);
+
+    pins.run(1, 100);
+    us_timestamp_t edgeTime = encoder.now();
+    QEI_CHECK_EQUAL(0, encoder.read());
+
+    //Counted by the Timeout, with the time of the edge.
+    host_advance_us(60);
+    QEI_CHECK_EQUAL(1, encoder.read());
+    QEIEdgeRecord record = {0, 0, 0, 0, 0};
+    QEI_CHECK_EQUAL(1, edgeLog.pop(&record, 1));
+    QEI_CHECK_EQUAL((uint32_t)edgeTime, record.time);
+
+    //Edges closer than the width still count when they keep moving.
+    pins.run(20, 10);
+    host_advance_us(60);
+    QEI_CHECK_EQUAL(21, encoder.read());
+    QEI_CHECK_EQUAL(0, encoder.getRejectedEdges());
+}
@@ -0,0 +1,90 @@
+#include "qei_test.h"
+#include "QEI.h"
+
+//Exact value of the ratio applied to a Q16.16 value, in LSB.
+static double exactQ16(int64_t valueQ16, int32_t nNumerator, int32_t nDenominator)
+{
+    return (double)valueQ16 * nNumerator / nDenominator;
+}
+
+QEI_TEST(fixedScaleWithinOneLsb)
+{
+    static const int32_t ratios[][2] = {{1, 1}, {360, 4096}, {360, 2000}, {1, 3}, {-7, 11}, {60, 1024}, {1000, 3}, {1, 2147483647}};
+    static const int64_t counts[] = {0, 1, -1, 3, 999, -12345, 1 << 20, -(1 << 22), 2147483647, -2147483647};
+
+    for (unsigned int r = 0; r < sizeof(ratios) / sizeof(ratios[0]); r++)
+    {
+        int64_t scale = qei_ratio_q48(ratios[r][0], ratios[r][1]);
+        for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+        {
+            //Whole counts and counts with a fraction, as the interpolated getter passes.
+            for (int64_t fraction = 0; fraction < 65536; fraction += 21845)
+            {
+                int64_t valueQ16 = counts[c] * 65536 + fraction;
+                double exact = exactQ16(valueQ16, ratios[r][0], ratios[r][1]);
+                if (exact >= 2147483647.0 || exact <= -2147483648.0)
+                    continue;
+                QEI_CHECK_CLOSE(exact, qei_scale_q48(valueQ16, scale), 1.0);
+            }
+        }
+    }
+}
+
+QEI_TEST(fixedPositionMatchesFloat)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    encoder.setPositionFactor(360.0f / 2000.0f);
+    encoder.setPositionRatio(360, 2000);
+
+    pins.run(-12345, 10);
+    //Float only has 24 bits, so it is within a few LSB of Q16.16 at this size.
+    QEI_CHECK_CLOSE(65536.0 * encoder.getPosition(), encoder.getPositionQ16(), 32.0);
+    QEI_CHECK_EQUAL(-145627546, encoder.getPositionQ16()); //-2222.1 deg
+}
+
+QEI_TEST(fixedSpeedMatchesFloat)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    encoder.setSpeedRatio(60, 2000);
+
+    pins.run(100, 300);
+    encoder.getSpeedQ16();
+    pins.run(100, 300);
+
+    //3333.33 Hz, 100 rpm at 2000 counts per revolution.
+    QEI_CHECK_CLOSE(100.0 * 65536, encoder.getSpeedQ16(), 1.0);
+}
+
+QEI_TEST(fixedScaleSaturates)
+{
+    int64_t one = qei_ratio_q48(1, 1);
+
+    //Limits of Q16.16 stay exact, one LSB beyond saturates.
+    QEI_CHECK_EQUAL(INT32_MAX, qei_scale_q48(INT32_MAX, one));
+    QEI_CHECK_EQUAL(INT32_MIN, qei_scale_q48(INT32_MIN, one));
+    QEI_CHECK_EQUAL(INT32_MAX, qei_scale_q48((int64_t)INT32_MAX + 1, one));
+    QEI_CHECK_EQUAL(INT32_MIN, qei_scale_q48((int64_t)INT32_MIN - 1, one));
+
+    //Far out of range, where the old 64-bit product overflowed.
+    QEI_CHECK_EQUAL(INT32_MAX, qei_scale_q48(655360000000LL, qei_ratio_q48(1000, 3)));
+    QEI_CHECK_EQUAL(INT32_MIN, qei_scale_q48(655360000000LL, qei_ratio_q48(-1000, 3)));
+    QEI_CHECK_EQUAL(INT32_MIN, qei_scale_q48(INT64_MIN, one));
+}
+
+QEI_TEST(fixedPositionSaturates)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+
+    //Beyond 32767 counts at 1/1, a revolution of a 10k line X4 encoder.
+    encoder.write(100000);
+    QEI_CHECK_EQUAL(INT32_MAX, encoder.getPositionQ16());
+    encoder.write(-100000);
+    QEI_CHECK_EQUAL(INT32_MIN, encoder.getPositionQ16());
+
+    //In revolutions of 40000 counts it fits.
+    encoder.setPositionRatio(1, 40000);
+    QEI_CHECK_EQUAL(-163840, encoder.getPositionQ16());
+}
@@ -0,0 +1,118 @@
+#include "qei_test.h"
+#include "QEI.h"
+
+//Index channel on pin 2, one pulse.
+static void indexPulse()
+{
+    host_advance_us(10);
+    host_pin_write(2, 1);
+    host_advance_us(10);
+    host_pin_write(2, 0);
+}
+
+QEI_TEST(indexCountLatchesPulses)
+{
+    host_pin_set(2, 0);
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, 2, QEI::X4_ENCODING);
+
+    pins.run(100, 10);
+    indexPulse();
+    QEI_CHECK_EQUAL(1, encoder.getRevolutions());
+    QEI_CHECK_EQUAL(100, encoder.getIndexPulses());
+    QEI_CHECK_EQUAL(100, encoder.read());
+
+    //Either direction counts a revolution, the count is left alone.
+    pins.run(-30, 10);
+    indexPulse();
+    QEI_CHECK_EQUAL(2, encoder.getRevolutions());
+    QEI_CHECK_EQUAL(70, encoder.getIndexPulses());
+    QEI_CHECK_EQUAL(70, encoder.read());
+}
+
+QEI_TEST(indexResetZeroesCount)
+{
+    host_pin_set(2, 0);
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, 2, QEI::X4_ENCODING);
+    encoder.setIndexMode(QEI::INDEX_RESET);
+
+    pins.run(100, 10);
+    indexPulse();
+    QEI_CHECK_EQUAL(0, encoder.read());
+    QEI_CHECK_EQUAL(100, encoder.getIndexPulses());
+
+    pins.run(-5, 10);
+    QEI_CHECK_EQUAL(-5, encoder.read());
+    indexPulse();
+    QEI_CHECK_EQUAL(0, encoder.read());
+    QEI_CHECK_EQUAL(2, encoder.getRevolutions());
+}
+
+QEI_TEST(indexCountsMismatches)
+{
+    host_pin_set(2, 0);
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, 2, QEI::X4_ENCODING);
+    encoder.setCountsPerRevolution(400);
+
+    indexPulse();
+    pins.run(400, 10);
+    indexPulse();
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().indexMismatches);
+
+    //Two edges lost in a revolution: counted, the count stays as decoded.
+    pins.run(200, 10);
+    pins.skip();
+    pins.run(198, 10);
+    indexPulse();
+    QEIDiagnostics diagnostics = encoder.getDiagnostics();
+    QEI_CHECK_EQUAL(1, diagnostics.invalidTransitions);
+    QEI_CHECK_EQUAL(1, diagnostics.indexMismatches);
+    QEI_CHECK_EQUAL(-2, diagnostics.lastIndexError);
+    QEI_CHECK_EQUAL(798, encoder.read());
+
+    encoder.resetDiagnostics();
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().indexMismatches);
+    QEI_CHECK_EQUAL(0, encoder.getDiagnostics().lastIndexError);
+}
+
+QEI_TEST(indexCorrectSnapsToRevolution)
+{
+    host_pin_set(2, 0);
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, 2, QEI::X4_ENCODING);
+    encoder.setIndexMode(QEI::INDEX_CORRECT);
+    encoder.setCountsPerRevolution(400);
+
+    //The first index edge is the reference, later ones snap to whole revolutions from it.
+    pins.run(50, 10);
+    indexPulse();
+    QEI_CHECK_EQUAL(50, encoder.read());
+    pins.run(400, 10);
+    indexPulse();
+    QEI_CHECK_EQUAL(450, encoder.read());
+
+    pins.run(200, 10);
+    pins.skip();
+    pins.run(198, 10);
+    QEI_CHECK_EQUAL(848, encoder.read());
+    indexPulse();
+    QEI_CHECK_EQUAL(1, encoder.getDiagnostics().indexMismatches);
+    QEI_CHECK_EQUAL(-2, encoder.getDiagnostics().lastIndexError);
+    QEI_CHECK_EQUAL(850, encoder.read());
+
+    //Backwards too, the next revolution is clean again.
+    pins.run(-400, 10);
+    indexPulse();
+    QEI_CHECK_EQUAL(450, encoder.read());
+    QEI_CHECK_EQUAL(1, encoder.getDiagnostics().indexMismatches);
+
+    //write() drops the reference, the next index edge sets a new one.
+    encoder.write(7);
+    indexPulse();
+    QEI_CHECK_EQUAL(7, encoder.read());
+    pins.run(399, 10);
+    indexPulse();
+    QEI_CHECK_EQUAL(407, encoder.read());
+}
@@ -0,0 +1,37 @@
+#include "qei_test.h"
+#include "QEIProfiler.h"
+
+QEI_TEST(profilerDecodesThroughTheEdgePath)
+{
+    QEIProfile report[QEI_PROFILE_METHODS];
+    QEIProfiler profiler(QEI::X4_ENCODING);
+
+    profiler.run(QEI_PATTERN_FORWARD, 4, 100, report, 10);
+    QEI_CHECK_EQUAL(100, profiler.read());
+    QEI_CHECK_EQUAL(100, report[QEI_PROFILE_ENCODE].calls);
+    QEI_CHECK_EQUAL(10, report[QEI_PROFILE_GET_SPEED].calls);
+    QEI_CHECK_EQUAL(10, profiler.getRevolutions());
+}
+
+QEI_TEST(profilerX2SkipsChannelBOnlyStates)
+{
+    QEIProfile report[QEI_PROFILE_METHODS];
+
+    QEIProfiler forward(QEI::X2_ENCODING);
+    forward.run(QEI_PATTERN_FORWARD, 4, 100, report);
+    QEI_CHECK_EQUAL(50, report[QEI_PROFILE_ENCODE].calls);
+
+    QEIProfiler jitter(QEI::X2_ENCODING);
+    jitter.run(QEI_PATTERN_JITTER, 4, 100, report);
+    QEI_CHECK_EQUAL(0, report[QEI_PROFILE_ENCODE].calls);
+    QEI_CHECK_EQUAL(0, jitter.read());
+}
+
+QEI_TEST(profileDecoderX2SkipsChannelBOnlyStates)
+{
+    QEIProfile profile = qei_profile_decoder(QEIDecoder::X2_ENCODING, QEI_PATTERN_FORWARD, 4, 100);
+    QEI_CHECK_EQUAL(50, profile.calls);
+
+    profile = qei_profile_decoder(QEIDecoder::X4_ENCODING, QEI_PATTERN_FORWARD, 4, 100);
+    QEI_CHECK_EQUAL(100, profile.calls);
+}
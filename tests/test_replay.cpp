@@ -0,0 +1,192 @@
+#include "qei_test.h"
+#include "QEIReplay.h"
+
+static const int forward[4] = {0x0, 0x1, 0x3, 0x2};
+
+//Speed samples of the last replay.
+static int replaySamples;
+static us_timestamp_t replayLastTime;
+static float replayLastSpeed;
+
+static void replaySpeed(us_timestamp_t time, float speed)
+{
+    replaySamples++;
+    replayLastTime = time;
+    replayLastSpeed = speed;
+}
+
+//nEdges forward edges nInterval apart after the initial state, an index pulse every nIndexEvery edges.
+static size_t replayTrace(uint8_t *buffer, size_t capacity, int nEdges, uint64_t nInterval, int nIndexEvery)
+{
+    QEITraceWriter writer(buffer, capacity);
+    uint64_t time = 0;
+
+    writer.add(time, forward[0]);
+    for (int i = 1; i <= nEdges; i++)
+    {
+        time += nInterval;
+        writer.add(time, forward[i & 3]);
+        if (nIndexEvery > 0 && i % nIndexEvery == 0)
+            writer.add(time, forward[i & 3], true);
+    }
+    return writer.size();
+}
+
+QEI_TEST(traceRoundTrip)
+{
+    uint8_t buffer[64];
+    QEITraceWriter writer(buffer, sizeof(buffer));
+
+    QEI_CHECK(writer.add(5, 0x1));
+    QEI_CHECK(writer.add(5, 0x1, true));
+    QEI_CHECK(writer.add(1000000, 0x3));
+    //Time going backwards leaves the trace unchanged.
+    size_t size = writer.size();
+    QEI_CHECK(!writer.add(999999, 0x2));
+    QEI_CHECK_EQUAL(size, writer.size());
+
+    QEITraceReader reader(buffer, writer.size());
+    QEITraceEvent event;
+    QEI_CHECK(reader.isValid());
+
+    QEI_CHECK(reader.next(event));
+    QEI_CHECK_EQUAL(5, event.time);
+    QEI_CHECK_EQUAL(0x1, event.state);
+    QEI_CHECK(!event.index);
+
+    QEI_CHECK(reader.next(event));
+    QEI_CHECK_EQUAL(5, event.time);
+    QEI_CHECK(event.index);
+
+    QEI_CHECK(reader.next(event));
+    QEI_CHECK_EQUAL(1000000, event.time);
+    QEI_CHECK_EQUAL(0x3, event.state);
+
+    QEI_CHECK(!reader.next(event));
+    QEI_CHECK(!reader.hasError());
+}
+
+QEI_TEST(traceWriterStopsWhenFull)
+{
+    uint8_t buffer[QEI_TRACE_HEADER + 2];
+    QEITraceWriter writer(buffer, sizeof(buffer));
+
+    QEI_CHECK(writer.add(1, 0x1));
+    //A second apart needs three bytes, only one is left.
+    QEI_CHECK(!writer.add(1000001, 0x3));
+    QEI_CHECK_EQUAL(QEI_TRACE_HEADER + 1, writer.size());
+    QEI_CHECK(writer.add(2, 0x3));
+    QEI_CHECK_EQUAL(sizeof(buffer), writer.size());
+}
+
+QEI_TEST(traceReaderFlagsTruncatedRecord)
+{
+    uint8_t buffer[16];
+    QEITraceWriter writer(buffer, sizeof(buffer));
+    writer.add(1000000, 0x1);
+
+    //Cut the last byte of the three byte record.
+    QEITraceReader reader(buffer, writer.size() - 1);
+    QEITraceEvent event;
+    QEI_CHECK(reader.isValid());
+    QEI_CHECK(!reader.next(event));
+    QEI_CHECK(reader.hasError());
+
+    buffer[0] = 'X';
+    QEI_CHECK(!QEITraceReader(buffer, writer.size()).isValid());
+}
+
+QEI_TEST(replayCountsEdgesAndIndex)
+{
+    static uint8_t trace[4096];
+    size_t size = replayTrace(trace, sizeof(trace), 1000, 10, 400);
+
+    QEIReplay replay(QEI::X4_ENCODING);
+    QEIReplayResult result;
+    QEI_CHECK(replay.run(trace, size, 0, result));
+
+    QEI_CHECK_EQUAL(1000, result.edges);
+    QEI_CHECK_EQUAL(2, result.indexPulses);
+    QEI_CHECK_EQUAL(1000, result.pulses);
+    QEI_CHECK_EQUAL(replay.getRevolutions(), result.revolutions);
+    QEI_CHECK_EQUAL(10000, result.duration);
+    QEI_CHECK(!result.error);
+    QEI_CHECK_EQUAL(0, replay.getDiagnostics().invalidTransitions);
+
+    //A second run starts from scratch.
+    QEI_CHECK(replay.run(trace, size, 0, result));
+    QEI_CHECK_EQUAL(1000, result.pulses);
+}
+
+QEI_TEST(replayX2SkipsChannelBRecords)
+{
+    static uint8_t trace[4096];
+    size_t size = replayTrace(trace, sizeof(trace), 1000, 10, 0);
+
+    QEIReplay replay(QEI::X2_ENCODING);
+    QEIReplayResult result;
+    QEI_CHECK(replay.run(trace, size, 0, result));
+    QEI_CHECK_EQUAL(500, result.edges);
+
+    //Same count as the channel A interrupts of a live encoder.
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X2_ENCODING);
+    pins.run(1000, 10);
+    QEI_CHECK_EQUAL(encoder.read(), result.pulses);
+}
+
+QEI_TEST(replaySamplesSpeedAtTraceTime)
+{
+    static uint8_t trace[4096];
+    //100000 edges per second for 10 ms.
+    size_t size = replayTrace(trace, sizeof(trace), 1000, 10, 0);
+
+    QEIReplay replay(QEI::X4_ENCODING);
+    QEIReplayResult result;
+    replaySamples = 0;
+    QEI_CHECK(replay.run(trace, size, 1000, result, callback(replaySpeed)));
+
+    //Samples due at 1 ms up to the last record at 10 ms.
+    QEI_CHECK_EQUAL(10, replaySamples);
+    QEI_CHECK_EQUAL(10000, replayLastTime);
+    QEI_CHECK_CLOSE(100000, replayLastSpeed, 1000);
+}
+
+QEI_TEST(replayFlagsMalformedTrace)
+{
+    static uint8_t trace[4096];
+    size_t size = replayTrace(trace, sizeof(trace), 100, 10, 0);
+    //Continuation bit on the last byte, the record is truncated.
+    trace[size - 1] |= 0x80;
+
+    QEIReplay replay(QEI::X4_ENCODING);
+    QEIReplayResult result;
+    QEI_CHECK(!replay.run(trace, size, 0, result));
+    QEI_CHECK(result.error);
+    QEI_CHECK_EQUAL(99, result.pulses);
+}
+
+QEI_TEST(unconnectedPinsKeepTheirHandlers)
+{
+    unsigned int handlers = host_nc_handlers();
+    {
+        QEIReplay replay(QEI::X4_ENCODING);
+        QEI encoder(0, NC, NC, QEI::X2_ENCODING);
+    }
+    QEI_CHECK_EQUAL(handlers, host_nc_handlers());
+}
+
+QEI_TEST(replayMeasuresRealTime)
+{
+    static uint8_t trace[1 << 18];
+    size_t size = replayTrace(trace, sizeof(trace), 100000, 10, 0);
+
+    //The simulated time does not move during a replay, the throughput uses the real clock.
+    us_timestamp_t simulated = host_time_us();
+    QEIReplay replay(QEI::X4_ENCODING);
+    QEIReplayResult result;
+    QEI_CHECK(replay.run(trace, size, 1000, result));
+    QEI_CHECK_EQUAL(simulated, host_time_us());
+    QEI_CHECK(result.elapsed > 0);
+    QEI_CHECK(result.edgeRate > 0);
+}
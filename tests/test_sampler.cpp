@@ -0,0 +1,59 @@
+#include "qei_test.h"
+#include "QEISampler.h"
+
+class TestSampler : public QEISampler
+{
+
+public:
+    TestSampler(PinName channelA, PinName channelB, us_timestamp_t nPeriod) : QEISampler(channelA, channelB, nPeriod) {}
+
+    using QEISampler::_nSampleTime;
+};
+
+QEI_TEST(samplerCountsWithProcess)
+{
+    QEITestEncoder pins(2, 3);
+    TestSampler sampler(2, 3, 10);
+
+    for (int i = 0; i < 10; i++)
+    {
+        pins.run(10, 40);
+        sampler.process();
+    }
+    host_advance_us(10); //Sample the last edge
+    QEI_CHECK_EQUAL(100, sampler.read());
+    QEI_CHECK_EQUAL(0, sampler.getOverflows());
+    QEI_CHECK(sampler.isPositionValid());
+}
+
+QEI_TEST(samplerOverflowKeepsTimeAndFlagsPosition)
+{
+    QEITestEncoder pins(2, 3);
+    TestSampler sampler(2, 3, 10);
+
+    //400 samples into a 256 sample buffer, without process().
+    pins.run(100, 40);
+    QEI_CHECK_EQUAL(400 - QEI_SAMPLER_BUFFER, sampler.getOverflows());
+    QEI_CHECK(!sampler.isPositionValid());
+
+    //The first sample after the gap accounts for the dropped ones.
+    sampler.process();
+    host_advance_us(10);
+    sampler.process();
+    QEI_CHECK_EQUAL(4010, sampler._nSampleTime);
+
+    //The speed only depends on the sample times, which stayed right.
+    for (int i = 0; i < 10; i++)
+    {
+        pins.run(10, 40);
+        sampler.getSpeed();
+    }
+    QEI_CHECK_CLOSE(25000.0, sampler.getSpeed(), 1.0);
+
+    host_advance_us(10);
+    sampler.write(0);
+    QEI_CHECK(sampler.isPositionValid());
+    pins.run(20, 40);
+    host_advance_us(10);
+    QEI_CHECK_EQUAL(20, sampler.read());
+}
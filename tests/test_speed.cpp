@@ -0,0 +1,175 @@
+#include "qei_test.h"
+#include "QEI.h"
+#include "QEISpeed.h"
+
+QEI_TEST(speedAcross32BitMicrosecondWrap)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+
+    //Edges every 1000 us straddling 2^32 us of the speed timer.
+    host_advance_us((1ULL << 32) - 5500);
+    pins.run(5, 1000);
+    encoder.getSpeed();
+    pins.run(5, 1000);
+    QEI_CHECK_CLOSE(1000.0, encoder.getSpeed(), 0.01);
+    pins.run(5, 1000);
+    QEI_CHECK_CLOSE(1000.0, encoder.getSpeed(), 0.01);
+}
+
+QEI_TEST(speedAfterGapLongerThan32Bits)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+
+    pins.run(10, 1000);
+    encoder.getSpeed();
+
+    //One edge after more than 2^32 us, a 32-bit delta would be 1000 us.
+    pins.run(1, (1ULL << 32) + 1000);
+    QEI_CHECK_CLOSE(1000000.0 / ((1ULL << 32) + 1000), encoder.getSpeed(), 1e-6);
+
+    pins.run(10, 1000);
+    QEI_CHECK_CLOSE(1000.0, encoder.getSpeed(), 0.01);
+}
+
+//Starts the running totals just below the signed 32-bit limit.
+class WrappedSpeedEstimator : public QEISpeedEstimator
+{
+
+public:
+    WrappedSpeedEstimator()
+    {
+        _nPulses = 0x7FFFFFF0;
+    }
+};
+
+QEI_TEST(speedTotalsWrapPastInt32Max)
+{
+    WrappedSpeedEstimator speed;
+    uint64_t time = 0;
+
+    speed.edge(1, time += 100);
+    speed.sample(time);
+    for (int i = 0; i < 40; i++)
+        speed.edge(1, time += 100);
+    speed.sample(time);
+    QEI_CHECK_EQUAL(40, speed.getCounts());
+    QEI_CHECK_EQUAL(4000, speed.getTime());
+
+    for (int i = 0; i < 40; i++)
+        speed.edge(-1, time += 100);
+    speed.sample(time);
+    QEI_CHECK_EQUAL(-40, speed.getCounts());
+}
+
+QEI_TEST(speedReversalStraddlingSample)
+{
+    QEISpeedEstimator speed;
+
+    //Dither on a stationary shaft: forward at 999 us, back at 1002 us, samples every 1000 us.
+    speed.edge(1, 999);
+    speed.sample(1000);
+    speed.edge(-1, 1002);
+    speed.sample(2000);
+    QEI_CHECK_CLOSE(-1000.0, speed.getSpeed(1.0f), 1.0);
+
+    //Back and forth within one sample interval, one net pulse over the edge window of 1504 us.
+    speed.edge(1, 2500);
+    speed.edge(-1, 2503);
+    speed.edge(1, 2506);
+    speed.sample(3000);
+    QEI_CHECK_CLOSE(1000000.0 / 1504, speed.getSpeed(1.0f), 0.01);
+
+    //Steady again in one direction, back to the edge period.
+    speed.edge(1, 3100);
+    speed.sample(4000);
+    speed.edge(1, 4100);
+    speed.sample(5000);
+    QEI_CHECK_CLOSE(1000.0, speed.getSpeed(1.0f), 0.01);
+}
+
+QEI_TEST(speedInterpolatesBetweenEdges)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+
+    //Without an estimate there is nothing to extrapolate.
+    pins.run(5, 1000);
+    host_advance_us(500);
+    QEI_CHECK_EQUAL(5 * 65536, encoder.getPositionInterpolatedQ16());
+
+    //One pulse per 1000 us.
+    pins.run(10, 1000);
+    encoder.getSpeed();
+    pins.run(10, 1000);
+    encoder.getSpeed();
+    QEI_CHECK_EQUAL(25 * 65536, encoder.getPositionInterpolatedQ16());
+
+    host_advance_us(250);
+    QEI_CHECK_EQUAL(25 * 65536 + 16384, encoder.getPositionInterpolatedQ16());
+    QEI_CHECK_CLOSE(25.25, encoder.getPositionInterpolated(), 1e-4);
+
+    //Clamped below the next count until its edge arrives.
+    host_advance_us(749);
+    QEI_CHECK_EQUAL(25 * 65536 + 65470, encoder.getPositionInterpolatedQ16());
+    host_advance_us(5000);
+    QEI_CHECK_EQUAL(25 * 65536 + 65535, encoder.getPositionInterpolatedQ16());
+    QEI_CHECK(encoder.getPositionInterpolated() < 26.0f);
+
+    pins.run(1, 10);
+    QEI_CHECK_EQUAL(26 * 65536, encoder.getPositionInterpolatedQ16());
+}
+
+QEI_TEST(speedInterpolatesBackwards)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+
+    pins.run(-10, 1000);
+    encoder.getSpeed();
+    pins.run(-10, 1000);
+    encoder.getSpeed();
+
+    host_advance_us(500);
+    QEI_CHECK_EQUAL(-20 * 65536 - 32768, encoder.getPositionInterpolatedQ16());
+    host_advance_us(5000);
+    QEI_CHECK_EQUAL(-20 * 65536 - 65535, encoder.getPositionInterpolatedQ16());
+}
+
+QEI_TEST(speedAccelerationFromEstimates)
+{
+    QEITestEncoder pins(0, 1);
+    QEI encoder(0, 1, NC, QEI::X4_ENCODING);
+    const double step = 1e6 / 600;
+
+    //step pulses per second more every 60 ms, estimated every 60 ms.
+    pins.run(10, 600);
+    encoder.getSpeed();
+    pins.run(100, 600);
+    QEI_CHECK_CLOSE(step, encoder.getSpeed(), 0.01);
+    QEI_CHECK_EQUAL(0.0f, encoder.getAcceleration());
+    pins.run(200, 300);
+    QEI_CHECK_CLOSE(2 * step, encoder.getSpeed(), 0.01);
+    QEI_CHECK_CLOSE(step / 0.06, encoder.getAcceleration(), 0.1);
+    pins.run(300, 200);
+    QEI_CHECK_CLOSE(3 * step, encoder.getSpeed(), 0.01);
+    QEI_CHECK_CLOSE(step / 0.06, encoder.getAcceleration(), 0.1);
+
+    //Scaled like the speed, here to revolutions of 2000 pulses.
+    encoder.setSpeedFactor(1.0f / 2000.0f);
+    pins.run(400, 150);
+    QEI_CHECK_CLOSE(4 * step / 2000, encoder.getSpeed(), 1e-5);
+    QEI_CHECK_CLOSE(step / 0.06 / 2000, encoder.getAcceleration(), 1e-4);
+
+    //Slowing down forward is negative, speeding up backward too.
+    encoder.setSpeedFactor(1.0f);
+    pins.run(300, 200);
+    QEI_CHECK_CLOSE(3 * step, encoder.getSpeed(), 0.01);
+    QEI_CHECK_CLOSE(-step / 0.06, encoder.getAcceleration(), 0.1);
+    pins.run(-100, 600);
+    encoder.getSpeed();
+    pins.run(-200, 300);
+    QEI_CHECK_CLOSE(-2 * step, encoder.getSpeed(), 0.01);
+    QEI_CHECK_CLOSE(-step / 0.06, encoder.getAcceleration(), 0.1);
+}
@@ -0,0 +1,63 @@
+#include "qei_test.h"
+#include "QEITimer.h"
+#include "PeripheralPins.h"
+
+QEI_TEST(timerKeepsCountWithoutReads)
+{
+    host_tim_reset();
+    QEITimer encoder(PA_6, PA_7);
+
+    //Several 16-bit wraps each way, with no read in between.
+    host_tim_count(TIM3, 200000);
+    QEI_CHECK_EQUAL(200000, encoder.read64());
+    host_tim_count(TIM3, -450000);
+    QEI_CHECK_EQUAL(-250000, encoder.read64());
+}
+
+QEI_TEST(timerJitterAroundWrap)
+{
+    host_tim_reset();
+    QEITimer encoder(PA_8, PA_9);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        host_tim_count(TIM1, 3);
+        host_tim_count(TIM1, -5);
+    }
+    QEI_CHECK_EQUAL(-2000, encoder.read());
+
+    encoder.write64(1LL << 40);
+    host_tim_count(TIM1, 70000);
+    QEI_CHECK_EQUAL((1LL << 40) + 70000, encoder.read64());
+}
+
+QEI_TEST(timerCompareStaysAroundCount)
+{
+    host_tim_reset();
+    QEITimer encoder(PB_6, PB_7);
+
+    host_tim_count(TIM4, QEI_TIMER_GUARD - 1);
+    QEI_CHECK_EQUAL(0, TIM4->SR.value & (TIM_SR_CC3IF | TIM_SR_CC4IF));
+    QEI_CHECK_EQUAL(QEI_TIMER_GUARD, TIM4->CCR3.value);
+
+    //The match folds the count and moves both compares along.
+    host_tim_count(TIM4, 1);
+    QEI_CHECK_EQUAL(2 * QEI_TIMER_GUARD, TIM4->CCR3.value);
+    QEI_CHECK_EQUAL(0, TIM4->CCR4.value);
+    QEI_CHECK_EQUAL(QEI_TIMER_GUARD, encoder.read());
+}
+
+QEI_TEST(timerDestructorReleasesTimer)
+{
+    host_tim_reset();
+    {
+        QEITimer encoder(PA_0, PA_1);
+        host_tim_count(TIM2, 10);
+        QEI_CHECK_EQUAL(10, encoder.read());
+    }
+    QEI_CHECK_EQUAL(0, TIM2->DIER.value);
+    QEI_CHECK_EQUAL(0, TIM2->CR1.value & TIM_CR1_CEN);
+
+    QEITimer encoder(PA_0, PA_1);
+    QEI_CHECK_EQUAL(0, encoder.read());
+}